@@ -26,31 +26,67 @@
 
 #endif
 
-#include <vector> // std::vector
+#include <cmath>   // std::abs, std::sqrt
+#include <cstdint> // std::int64_t
+#include <limits>  // std::numeric_limits
+#include <vector>  // std::vector
 
 namespace QuantPDE {
 
-#if EIGEN_VERSION_AT_LEAST(3,2,90)
+// The index type is used both for indexing nodes and for the indices stored in
+// sparse matrices. Define QUANT_PDE_64BIT_INDEX (or QUANT_PDE_INDEX to pick any
+// signed integer type) for grids whose matrices have more than 2^31 - 1
+// nonzeros.
+#if defined(QUANT_PDE_INDEX)
+typedef QUANT_PDE_INDEX Index;
+#elif defined(QUANT_PDE_64BIT_INDEX)
+typedef std::int64_t Index;
+#elif EIGEN_VERSION_AT_LEAST(3,2,90)
 typedef Eigen::SparseMatrix<Real>::StorageIndex Index;
 #else
 typedef Eigen::SparseMatrix<Real>::Index Index;
 #endif
 
 typedef Eigen::Matrix<Real, Eigen::Dynamic, 1> Vector;
-typedef Eigen::SparseMatrix<Real, Eigen::RowMajor> Matrix;
+typedef Eigen::SparseMatrix<Real, Eigen::RowMajor, Index> Matrix;
 
-typedef Eigen::SparseMatrix<Real>::InnerIterator MatrixInnerIterator;
+typedef Eigen::SparseMatrix<Real, Eigen::ColMajor, Index>::InnerIterator
+		MatrixInnerIterator;
 
-typedef Eigen::VectorXi IntegerVector;
+typedef Eigen::Matrix<Index, Eigen::Dynamic, 1> IntegerVector;
 
 // BiCGSTAB with IncompleteLUT preconditioner
-typedef Eigen::BiCGSTAB<Matrix, Eigen::IncompleteLUT<Real>> BiCGSTAB;
+typedef Eigen::BiCGSTAB<Matrix, Eigen::IncompleteLUT<Real, Index>> BiCGSTAB;
 
 typedef Eigen::SparseLU<Matrix, Eigen::NaturalOrdering<Index>> SparseLU;
 
 ////////////////////////////////////////////////////////////////////////////////
 
-class Entry : public Eigen::Triplet<Real> {
+/**
+ * Throws if a matrix whose rows hold the given number of nonzeros each has more
+ * nonzeros than the index type can count (see QUANT_PDE_64BIT_INDEX).
+ * @param rows The number of rows.
+ * @param perRow The number of nonzeros in each row.
+ */
+inline void checkNonzeros(Index rows, Index perRow) {
+	if(perRow > 0 && rows > std::numeric_limits<Index>::max() / perRow) {
+		throw "error: the number of nonzeros does not fit in the index "
+				"type (define QUANT_PDE_64BIT_INDEX)";
+	}
+}
+
+/**
+ * @param rows The number of rows.
+ * @param perRow The number of nonzeros in each row.
+ * @return The argument to Matrix::reserve for this many nonzeros per row.
+ * @see QuantPDE::checkNonzeros
+ */
+inline IntegerVector nonzerosPerRow(Index rows, Index perRow) {
+	checkNonzeros(rows, perRow);
+	return IntegerVector::Constant(rows, perRow);
+}
+
+class Entry : public Eigen::Triplet<Real, Index> {
 
 public:
 
@@ -63,6 +99,14 @@ public:
 
 };
 
+} // QuantPDE
+
+// Parallel loops and matrix-vector products (which use the types above)
+#include "../Core/Parallel.hpp"
+#include "../Core/Memory.hpp"
+
+namespace QuantPDE {
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -135,6 +179,14 @@ public:
 		return A;
 	}
 
+	/**
+	 * @return The number of bytes held by this solver (the matrix and,
+	 *         e.g., its factors).
+	 */
+	virtual size_t memoryUsage() const {
+		return QuantPDE::memoryUsage(A);
+	}
+
 };
 
 /**
@@ -162,10 +214,100 @@ public:
 		return solver.solve(b);
 	}
 
+	virtual size_t memoryUsage() const {
+		if(A.rows() == 0) {
+			// Not factored yet
+			return LinearSolver::memoryUsage();
+		}
+
+		// The factors and the permutations
+		return LinearSolver::memoryUsage() + (solver.nnzL()
+				+ solver.nnzU()) * (sizeof(Real) + sizeof(Index))
+				+ 2 * A.rows() * sizeof(Index);
+	}
+
 };
 
 /**
- * Solves \f$Ax=b\f$ with BiCGSTAB.
+ * Solves \f$Ax=b\f$ with the (right-preconditioned) BiCGSTAB iteration of
+ * Eigen::BiCGSTAB, except that the matrix-vector products are computed in
+ * parallel.
+ * @param A The left-hand-side matrix.
+ * @param b The right-hand-side.
+ * @param x The initial guess on input and the solution on output.
+ * @param precondition Returns \f$M^{-1}y\f$ given \f$y\f$, where \f$M\f$
+ *                     is the preconditioner.
+ * @param tolerance The relative residual below which iterations stop.
+ * @param maxIterations The maximum number of iterations.
+ * @return The number of iterations.
+ * @see QuantPDE::multiply
+ */
+template <typename P>
+Index bicgstab(const Matrix &A, const Vector &b, Vector &x, P &&precondition,
+		Real tolerance, Index maxIterations) {
+	Vector r = b - multiply(A, x);
+	Vector r0 = r;
+
+	Real r0SquaredNorm = r0.squaredNorm();
+	const Real bSquaredNorm = b.squaredNorm();
+	if(bSquaredNorm == 0.) {
+		x.setZero();
+		return 0;
+	}
+
+	Real rho = 1., alpha = 1., omega = 1.;
+	Vector p = Vector::Zero(b.size()), q = p;
+	Vector s, t, y, z;
+
+	const Real threshold = tolerance * tolerance * bSquaredNorm;
+	const Real eps2 = std::numeric_limits<Real>::epsilon()
+			* std::numeric_limits<Real>::epsilon();
+
+	Index i = 0, restarts = 0;
+	while(r.squaredNorm() > threshold && i < maxIterations) {
+		const Real rhoOld = rho;
+
+		rho = r0.dot(r);
+		if(std::abs(rho) < eps2 * r0SquaredNorm) {
+			// The residual became too orthogonal to r0; restart with
+			// a new r0
+			r = b - multiply(A, x);
+			r0 = r;
+			rho = r0SquaredNorm = r.squaredNorm();
+			if(restarts++ == 0) {
+				i = 0;
+			}
+		}
+
+		const Real beta = (rho / rhoOld) * (alpha / omega);
+		p = r + beta * (p - omega * q);
+
+		y = precondition(p);
+		multiply(A, y, q);
+
+		alpha = rho / r0.dot(q);
+		s = r - alpha * q;
+
+		z = precondition(s);
+		multiply(A, z, t);
+
+		const Real tSquaredNorm = t.squaredNorm();
+		omega = tSquaredNorm > 0. ? t.dot(s) / tSquaredNorm : 0.;
+
+		x += alpha * y + omega * z;
+		r = s - omega * t;
+		++i;
+	}
+
+	assert( std::sqrt(r.squaredNorm() / bSquaredNorm) <= tolerance );
+	return i;
+}
+
+/**
+ * Solves \f$Ax=b\f$ with BiCGSTAB, preconditioned by an incomplete LU
+ * factorization.
+ *
+ * @see QuantPDE::bicgstab
  */
 class BiCGSTABSolver : public LinearSolver {
 
@@ -175,14 +317,15 @@ public:
 private:
 #endif
 
-	BiCGSTAB solver;
+	Eigen::IncompleteLUT<Real, Index> preconditioner;
 
 	virtual void initialize() {
+		firstTouch(A);
 
 		#ifndef VIENNACL_WITH_EIGEN
 
-			solver.compute(A);
-			assert( solver.info() == Eigen::Success );
+			preconditioner.compute(A);
+			assert( preconditioner.info() == Eigen::Success );
 
 		#endif
 
@@ -196,12 +339,23 @@ public:
 	BiCGSTABSolver() noexcept : LinearSolver() {
 	}
 
+	virtual size_t memoryUsage() const {
+		// Eigen does not expose the size of the incomplete factors; use
+		// the bound of IncompleteLUT (with the default fill factor of
+		// 10) on the number of entries kept in each row
+		const size_t n = A.rows();
+		const size_t fill = n ? (A.nonZeros() * 10) / n + 1 : 0;
+		return LinearSolver::memoryUsage() + n * (fill + 1)
+				* (sizeof(Real) + sizeof(Index));
+	}
+
 	virtual Vector solve(const Vector &b, const Vector &guess) {
 		#ifndef VIENNACL_WITH_EIGEN
 
-			Vector v = solver.solveWithGuess(b, guess);
-			assert( solver.info() == Eigen::Success );
-			its.push_back( solver.iterations() );
+			Vector v = guess;
+			its.push_back( bicgstab(A, b, v, [&] (const Vector &x) -> Vector {
+				return preconditioner.solve(x);
+			}, std::numeric_limits<Real>::epsilon(), 2 * A.cols()) );
 
 		#else
 
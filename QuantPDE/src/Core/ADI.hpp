@@ -0,0 +1,218 @@
+#ifndef QUANT_PDE_CORE_ADI_HPP
+#define QUANT_PDE_CORE_ADI_HPP
+
+#include <memory> // std::unique_ptr
+#include <vector> // std::vector
+
+namespace QuantPDE {
+
+/**
+ * A linear system whose matrix is split into a sum of components
+ * \f$A\left(t\right) = A_0\left(t\right) + A_1\left(t\right) + \cdots +
+ * A_{k-1}\left(t\right)\f$. Typically, \f$A_0\f$ holds the mixed derivative
+ * terms and \f$A_d\f$ (for \f$d > 0\f$) holds the terms involving only
+ * derivatives along the \f$d\f$-th direction, so that systems involving
+ * \f$A_d\f$ are cheap to solve.
+ *
+ * @see QuantPDE::DouglasADI
+ */
+class SplitLinearSystem : virtual public LinearSystem {
+
+public:
+
+	/**
+	 * @return The number of components.
+	 */
+	virtual Index components() const = 0;
+
+	/**
+	 * @param time The time.
+	 * @param k The index of the component.
+	 * @return The k-th component of the matrix.
+	 */
+	virtual Matrix component(Real time, Index k) = 0;
+
+};
+
+/**
+ * The Douglas alternating direction implicit (ADI) scheme
+ * @cite in2010adi .
+ *
+ * Let \f$\Delta t\equiv t^1 - t^0\f$ where \f$t^1\f$ is the current time and
+ * \f$t^0\f$ is the previous time. The zeroth component of the split system is
+ * treated explicitly, and each of the remaining components implicitly:
+ * \f{align*}{
+ * 	\mathbf{y}_0 &= \mathbf{x}^0 - A(t^0) \mathbf{x}^0 \Delta t
+ * 		+ \left[\theta b\left(t^1\right)
+ * 		+ \left(1 - \theta\right) b\left(t^0\right)\right] \Delta t \\
+ * 	\left[I + A_d(t^1)\theta\Delta t\right] \mathbf{y}_d &= \mathbf{y}_{d-1}
+ * 		+ A_d(t^0) \mathbf{x}^0 \theta\Delta t \\
+ * 	\mathbf{x}^1 &= \mathbf{y}_{k-1}
+ * \f}
+ *
+ * The systems above are solved (with a sparse direct method) within this node;
+ * the matrix this node hands to the LinearSolver is the identity. The
+ * factorizations are reused while the timestep and the split system do not
+ * change.
+ *
+ * @tparam ThetaInverse 2 is second order in time (for constant coefficients
+ *                      and no mixed derivatives). Larger values damp
+ *                      oscillations better (with the mixed terms, 2 is only
+ *                      stable for small correlations).
+ *
+ * @see QuantPDE::SplitLinearSystem
+ */
+template <bool Forward, int ThetaInverse = 2>
+class DouglasADI : public IterationNode {
+
+	static_assert(ThetaInverse > 0, "ThetaInverse must be positive.");
+
+	// GCC has trouble with this if NDEBUG is off
+	#ifndef NDEBUG
+	const Real theta = 1. / ((Real) ThetaInverse);
+	#else
+	static constexpr Real theta = 1. / ((Real) ThetaInverse);
+	#endif
+
+	// Direct solver for the implicit components; the ordering follows the
+	// lines of the grid, so there is no fill-in
+	typedef Eigen::SparseLU<Eigen::SparseMatrix<Real, Eigen::ColMajor,
+			Index>, Eigen::NaturalOrdering<Index>> Factorization;
+
+	const DomainBase &domain;
+	SplitLinearSystem &system;
+
+	std::vector<std::unique_ptr<Factorization>> factorizations;
+	Real factoredTimestep;
+
+	// Explicit matrices (reused if the split system does not change)
+	Matrix explicitA;
+	std::vector<Matrix> explicitComponents;
+
+	inline Real dt() const {
+		const Real
+			t1 = this->nextTime(),
+			t0 = this->time(0)
+		;
+
+		const Real dt = Forward ? t1 - t0 : t0 - t1;
+		assert(dt > QuantPDE::epsilon);
+
+		return dt;
+	}
+
+	void factorize(Real t1, Real h) {
+		const Index k = system.components();
+
+		// The split system need not be reentrant
+		std::vector<Matrix> M(k);
+		for(Index d = 1; d < k; ++d) {
+			M[d] = domain.identity() + system.component(t1, d)
+					* theta * h;
+		}
+
+		factorizations.resize(k);
+		parallelFor(1, k, [&] (Index d) {
+			factorizations[d] = std::unique_ptr<Factorization>(
+					new Factorization);
+			factorizations[d]->setPivotThreshold(0.);
+			factorizations[d]->compute(M[d]);
+			assert(factorizations[d]->info() == Eigen::Success);
+		});
+
+		factoredTimestep = h;
+	}
+
+	virtual Matrix A(Real) {
+		return this->domain.identity();
+	}
+
+	virtual Vector b(Real t1) {
+		const Real    t0 = this->time(0);
+		const Vector &v0 = this->iterand(0);
+		const Real    h  = dt();
+
+		const bool same = system.isATheSame();
+		if(factorizations.empty() || h != factoredTimestep || !same) {
+			factorize(t1, h);
+		}
+		if(explicitComponents.empty() || !same) {
+			explicitA = system.A(t0);
+			explicitComponents.resize(system.components());
+			for(Index d = 1; d < system.components(); ++d) {
+				explicitComponents[d] = system.component(t0, d);
+			}
+		}
+
+		// Explicit predictor
+		Vector y = v0 - multiply(explicitA, v0) * h
+				+ ( theta * system.b(t1)
+				+ (1 - theta) * system.b(t0) ) * h;
+
+		// Implicit corrections
+		for(Index d = 1; d < system.components(); ++d) {
+			const Vector rhs = y + multiply(explicitComponents[d],
+					v0) * (theta * h);
+			y = factorizations[d]->solve(rhs);
+		}
+
+		return y;
+	}
+
+	virtual void clear() {
+		factorizations.clear();
+		explicitComponents.clear();
+	}
+
+	virtual void onAfterEvent() {
+		// Do nothing; events do not change the split system
+	}
+
+public:
+
+	virtual bool isATheSame() const {
+		return true;
+	}
+
+	/**
+	 * @param domain The spatial domain to solve the problem on.
+	 * @param system The split system.
+	 */
+	template <typename D>
+	DouglasADI(
+		D &domain,
+		SplitLinearSystem &system
+	) noexcept :
+		domain(domain),
+		system(system),
+		factoredTimestep(-1.)
+	{
+	}
+
+	// Disable copy constructor and assignment operator.
+	DouglasADI(const DouglasADI &) = delete;
+	DouglasADI &operator=(const DouglasADI &) = delete;
+
+	virtual size_t memoryUsage() const {
+		size_t bytes = QuantPDE::memoryUsage(explicitA);
+		for(const Matrix &M : explicitComponents) {
+			bytes += QuantPDE::memoryUsage(M);
+		}
+		for(const auto &factorization : factorizations) {
+			if(factorization) {
+				bytes += (factorization->nnzL()
+						+ factorization->nnzU())
+						* (sizeof(Real) + sizeof(Index));
+			}
+		}
+		return bytes;
+	}
+
+};
+
+typedef DouglasADI<false> ReverseDouglasADI;
+typedef DouglasADI<true>  ForwardDouglasADI;
+
+} // QuantPDE
+
+#endif
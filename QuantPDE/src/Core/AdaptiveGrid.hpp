@@ -0,0 +1,792 @@
+#ifndef QUANT_PDE_CORE_ADAPTIVE_GRID_HPP
+#define QUANT_PDE_CORE_ADAPTIVE_GRID_HPP
+
+#include <algorithm> // std::lower_bound, std::sort, std::unique
+#include <array>     // std::array
+#include <cassert>   // assert
+#include <cmath>     // std::abs
+#include <cstdint>   // std::int64_t, std::intmax_t
+#include <limits>    // std::numeric_limits
+#include <memory>    // std::shared_ptr, std::unique_ptr
+#include <tuple>     // std::get
+#include <utility>   // std::forward, std::move
+#include <vector>    // std::vector
+
+namespace QuantPDE {
+
+/**
+ * A grid obtained by recursively splitting the cells of a rectilinear (base)
+ * grid into \f$2^n\f$ children (i.e. a forest of binary trees, quadtrees or
+ * octrees, one rooted at each cell of the base grid). The nodes of the grid are
+ * the vertices of the leaves.
+ *
+ * Refinement is local: only the cells selected by the user (e.g. those near a
+ * strike or an exercise boundary) are split. After each refinement, cells are
+ * split further so that adjacent (face-sharing) leaves differ by at most one
+ * level (2:1 balance).
+ *
+ * A node lying in the interior of a face of a larger adjacent leaf is a hanging
+ * node. Finite difference stencils (see AdaptiveGrid::neighbour) account for
+ * these: if the neighbour of a node in some direction is not itself a node, it
+ * is expressed as an interpolant of the nodes on the face of the leaf it lies
+ * on. Since the interpolation weights are nonnegative, positive coefficient
+ * discretizations remain positive.
+ *
+ * If no cells are split, the nodes (and their order) are the same as that of
+ * the base grid. In general, nodes are ordered as they would be on the finest
+ * rectilinear grid containing them.
+ *
+ * The grid is immutable; copies share the same underlying tree.
+ */
+template <Index Dimension>
+class AdaptiveGrid : public Domain<Dimension> {
+
+public:
+
+	/**
+	 * A coordinate on the lattice of the finest level: a tick of the base
+	 * grid with index i has lattice coordinate i 2^L, where L is the
+	 * maximum level.
+	 */
+	typedef std::int64_t Key;
+
+	typedef std::array<Key, Dimension> Point;
+
+	/**
+	 * The neighbour of a node in some coordinate direction, as a weighted
+	 * sum of the values at nodes.
+	 */
+	struct Neighbour {
+		Real distance;        // Zero if the node is on the boundary
+		Index size;           // Number of nodes (zero on the boundary)
+		const Index *nodes;
+		const Real *weights;
+	};
+
+private:
+
+	typedef IntegerPower<2, Dimension> Children;
+
+	struct Cell {
+		Point lower;
+		int level;
+		Index children; // Index of the first child (negative if a leaf)
+	};
+
+	struct Tree {
+		const RectilinearGrid<Dimension> base;
+		const int levels;
+
+		Index roots[Dimension];
+		std::vector<Cell> cells; // Roots first (in the order of the base)
+		Index leaves;
+
+		std::vector<Point> keys;
+		std::vector<std::array<Real, Dimension>> coordinates;
+
+		// Corners of the leaves (Children::value per cell; negative if
+		// the cell is not a leaf)
+		std::vector<Index> corners;
+
+		// Neighbour k = 2 (Dimension node + d) + forward occupies
+		// [offsets[k], offsets[k + 1]) in the stencil arrays
+		std::vector<Index> offsets;
+		std::vector<Real> distances;
+		std::vector<Index> stencilNodes;
+		std::vector<Real> stencilWeights;
+
+		Tree(const RectilinearGrid<Dimension> &base, int levels)
+				noexcept : base(base), levels(levels), leaves(0) {
+		}
+
+		Key size(int level) const {
+			return Key(1) << (levels - level);
+		}
+
+		Key upper(Index d) const {
+			return roots[d] << levels;
+		}
+
+		Real coordinate(Index d, Key key) const {
+			const Axis &axis = base[d];
+			Key b = key >> levels;
+			if(b == roots[d]) {
+				--b;
+			}
+			const Real f = (Real) (key - (b << levels))
+					/ (Real) size(0);
+			return axis[b] + (axis[b + 1] - axis[b]) * f;
+		}
+
+		// Nodes are ordered with the last axis most significant
+		static bool before(const Point &a, const Point &b) {
+			for(Index d = Dimension - 1; d >= 0; --d) {
+				if(a[d] != b[d]) {
+					return a[d] < b[d];
+				}
+			}
+			return false;
+		}
+
+		Index find(const Point &key) const {
+			auto it = std::lower_bound(keys.begin(), keys.end(),
+					key, &Tree::before);
+			if(it == keys.end() || *it != key) {
+				return -1;
+			}
+			return it - keys.begin();
+		}
+
+		void split(Index c) {
+			const Cell parent = cells[c];
+			assert(parent.children < 0);
+			assert(parent.level < levels);
+
+			const Key half = size(parent.level + 1);
+			cells[c].children = cells.size();
+			for(std::intmax_t k = 0; k < Children::value; ++k) {
+				Cell child;
+				child.level = parent.level + 1;
+				child.children = -1;
+				for(Index d = 0; d < Dimension; ++d) {
+					child.lower[d] = parent.lower[d]
+							+ ((k >> d) & 1) * half;
+				}
+				cells.push_back(child);
+			}
+		}
+
+		// Leaf containing the point key + epsilon * sign (negative if
+		// the point is outside of the domain)
+		Index locate(const Point &key, const int (&sign)[Dimension])
+				const {
+			Index c = 0, stride = 1;
+			for(Index d = 0; d < Dimension; ++d) {
+				Key b = key[d] >> levels;
+				if(key[d] == (b << levels) && sign[d] < 0) {
+					--b;
+				}
+				if(b < 0 || b >= roots[d]) {
+					return -1;
+				}
+				c += stride * b;
+				stride *= roots[d];
+			}
+
+			while(cells[c].children >= 0) {
+				const Cell &cell = cells[c];
+				const Key half = size(cell.level + 1);
+				Index k = 0;
+				for(Index d = 0; d < Dimension; ++d) {
+					const Key mid = cell.lower[d] + half;
+					if(key[d] > mid || (key[d] == mid
+							&& sign[d] > 0)) {
+						k += 1 << d;
+					}
+				}
+				c = cell.children + k;
+			}
+
+			return c;
+		}
+
+		// Splits leaves until adjacent leaves differ by at most one
+		// level
+		void balance() {
+			std::vector<Index> work;
+			for(Index c = 0; c < (Index) cells.size(); ++c) {
+				if(cells[c].children < 0) {
+					work.push_back(c);
+				}
+			}
+
+			int sign[Dimension];
+			while(!work.empty()) {
+				const Index c = work.back();
+				work.pop_back();
+
+				const Cell cell = cells[c];
+				if(cell.children >= 0 || cell.level < 2) {
+					continue;
+				}
+
+				for(Index d = 0; d < Dimension; ++d) {
+					for(int s = -1; s <= 1; s += 2) {
+						Point key = cell.lower;
+						for(Index e = 0; e < Dimension; ++e) {
+							sign[e] = 1;
+						}
+						sign[d] = s;
+						if(s > 0) {
+							key[d] += size(cell.level);
+						}
+
+						const Index n = locate(key, sign);
+						if(n < 0 || cells[n].level
+								>= cell.level - 1) {
+							continue;
+						}
+
+						split(n);
+						const Index first = cells[n].children;
+						for(
+							std::intmax_t k = 0;
+							k < Children::value;
+							++k
+						) {
+							work.push_back(first + k);
+						}
+
+						// The neighbour may still be too
+						// coarse
+						work.push_back(c);
+					}
+				}
+			}
+		}
+
+		void buildNodes() {
+			keys.clear();
+			leaves = 0;
+			for(const Cell &cell : cells) {
+				if(cell.children >= 0) {
+					continue;
+				}
+				++leaves;
+				for(
+					std::intmax_t k = 0;
+					k < Children::value;
+					++k
+				) {
+					Point key = cell.lower;
+					for(Index d = 0; d < Dimension; ++d) {
+						key[d] += ((k >> d) & 1)
+							* size(cell.level);
+					}
+					keys.push_back(key);
+				}
+			}
+
+			std::sort(keys.begin(), keys.end(), &Tree::before);
+			keys.erase(std::unique(keys.begin(), keys.end()),
+					keys.end());
+
+			coordinates.resize(keys.size());
+			for(Index i = 0; i < (Index) keys.size(); ++i) {
+				for(Index d = 0; d < Dimension; ++d) {
+					coordinates[i][d] = coordinate(d, keys[i][d]);
+				}
+			}
+
+			corners.assign(cells.size() * Children::value, -1);
+			for(Index c = 0; c < (Index) cells.size(); ++c) {
+				const Cell &cell = cells[c];
+				if(cell.children >= 0) {
+					continue;
+				}
+				for(
+					std::intmax_t k = 0;
+					k < Children::value;
+					++k
+				) {
+					Point key = cell.lower;
+					for(Index d = 0; d < Dimension; ++d) {
+						key[d] += ((k >> d) & 1)
+							* size(cell.level);
+					}
+					corners[c * Children::value + k] =
+							find(key);
+				}
+			}
+		}
+
+		void buildStencil(Index i, Index d, int s) {
+			const Point &key = keys[i];
+
+			offsets.push_back(stencilNodes.size());
+
+			// Boundary
+			if((s < 0 && key[d] == 0) || (s > 0 && key[d]
+					== upper(d))) {
+				distances.push_back(0.);
+				return;
+			}
+
+			// Of the leaves touching the segment starting at the
+			// node in the direction s e_d, pick the smallest
+			Index best = -1;
+			int sign[Dimension];
+			const Index others = Children::value / 2;
+			for(Index m = 0; m < others; ++m) {
+				bool valid = true;
+				Index bit = 0;
+				for(Index e = 0; e < Dimension; ++e) {
+					if(e == d) {
+						sign[e] = s;
+						continue;
+					}
+					sign[e] = ((m >> bit++) & 1) ? 1 : -1;
+					if((sign[e] < 0 && key[e] == 0)
+							|| (sign[e] > 0 && key[e]
+							== upper(e))) {
+						valid = false;
+					}
+				}
+				if(!valid) {
+					continue;
+				}
+
+				const Index c = locate(key, sign);
+				if(c >= 0 && (best < 0 || cells[c].level
+						> cells[best].level)) {
+					best = c;
+				}
+			}
+			assert(best >= 0);
+
+			// The neighbour lies on the far face of that leaf
+			const Cell &cell = cells[best];
+			const Key h = size(cell.level);
+			Point target = key;
+			target[d] = s > 0 ? cell.lower[d] + h : cell.lower[d];
+
+			distances.push_back(std::abs(coordinate(d, target[d])
+					- coordinates[i][d]));
+
+			const Index j = find(target);
+			if(j >= 0) {
+				stencilNodes.push_back(j);
+				stencilWeights.push_back(1.);
+				return;
+			}
+
+			// Hanging: interpolate on the face
+			for(std::intmax_t k = 0; k < Children::value; ++k) {
+				if(((k >> d) & 1) != (s > 0 ? 1 : 0)) {
+					continue;
+				}
+
+				Point corner = cell.lower;
+				Real weight = 1.;
+				for(Index e = 0; e < Dimension; ++e) {
+					const Key bit = (k >> e) & 1;
+					corner[e] += bit * h;
+					if(e == d) {
+						continue;
+					}
+					const Real t = (Real) (target[e]
+							- cell.lower[e]) / h;
+					weight *= bit ? t : 1. - t;
+				}
+
+				if(weight > QuantPDE::epsilon) {
+					const Index n = find(corner);
+					assert(n >= 0);
+					stencilNodes.push_back(n);
+					stencilWeights.push_back(weight);
+				}
+			}
+		}
+
+		void buildStencils() {
+			offsets.clear();
+			distances.clear();
+			stencilNodes.clear();
+			stencilWeights.clear();
+
+			const Index n = keys.size();
+			offsets.reserve(2 * Dimension * n + 1);
+			distances.reserve(2 * Dimension * n);
+			stencilNodes.reserve(2 * Dimension * n);
+			stencilWeights.reserve(2 * Dimension * n);
+
+			for(Index i = 0; i < n; ++i) {
+				for(Index d = 0; d < Dimension; ++d) {
+					buildStencil(i, d, -1);
+					buildStencil(i, d,  1);
+				}
+			}
+			offsets.push_back(stencilNodes.size());
+		}
+
+		void build() {
+			balance();
+			buildNodes();
+			buildStencils();
+		}
+	};
+
+	std::shared_ptr<const Tree> tree;
+
+	AdaptiveGrid(std::shared_ptr<const Tree> tree) noexcept
+			: tree(std::move(tree)) {
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param base The base grid (each axis must have at least two ticks).
+	 * @param levels The maximum number of times a cell of the base grid
+	 *               can be split.
+	 */
+	explicit AdaptiveGrid(
+		const RectilinearGrid<Dimension> &base,
+		int levels = 10
+	) {
+		assert(levels >= 0);
+
+		std::shared_ptr<Tree> t(new Tree(base, levels));
+
+		Index count = 1;
+		for(Index d = 0; d < Dimension; ++d) {
+			assert(base[d].size() > 1);
+			t->roots[d] = base[d].size() - 1;
+
+			// Make sure lattice coordinates are representable
+			assert(t->roots[d] <= std::numeric_limits<Key>::max()
+					>> (levels + 1));
+
+			count *= t->roots[d];
+		}
+
+		t->cells.resize(count);
+		for(Index c = 0; c < count; ++c) {
+			Index m = c;
+			for(Index d = 0; d < Dimension; ++d) {
+				t->cells[c].lower[d] = (m % t->roots[d])
+						<< levels;
+				m /= t->roots[d];
+			}
+			t->cells[c].level = 0;
+			t->cells[c].children = -1;
+		}
+
+		t->build();
+		tree = std::move(t);
+	}
+
+	/**
+	 * Copy constructor.
+	 */
+	AdaptiveGrid(const AdaptiveGrid &that) noexcept : tree(that.tree) {
+	}
+
+	AdaptiveGrid &operator=(const AdaptiveGrid &) = delete;
+
+	/**
+	 * A refined grid constructed by splitting the leaves selected by a
+	 * predicate (and then restoring the 2:1 balance). Leaves at the maximum
+	 * level are never split.
+	 *
+	 * The example below refines a two-dimensional grid near the line
+	 * \f$x = K\f$:
+	 * \code{.cpp}
+	 * auto refined = grid.refined(
+	 * 	[=] (const std::array<Real, 2> &lower,
+	 * 			const std::array<Real, 2> &upper) {
+	 * 		return lower[0] <= K && K <= upper[0];
+	 * 	},
+	 * 	4
+	 * );
+	 * \endcode
+	 * @param split Called with the lower and upper corners of each leaf;
+	 *              returns true if and only if the leaf should be split.
+	 * @param times Number of times to refine (default is 1).
+	 * @return A refined grid.
+	 */
+	template <typename F>
+	AdaptiveGrid refined(F &&split, int times = 1) const {
+		assert(times >= 0);
+
+		std::shared_ptr<Tree> t(new Tree(tree->base, tree->levels));
+		for(Index d = 0; d < Dimension; ++d) {
+			t->roots[d] = tree->roots[d];
+		}
+		t->cells = tree->cells;
+
+		std::array<Real, Dimension> lower, upper;
+		for(int i = 0; i < times; ++i) {
+			const Index n = t->cells.size();
+			for(Index c = 0; c < n; ++c) {
+				const Cell &cell = t->cells[c];
+				if(cell.children >= 0
+						|| cell.level >= t->levels) {
+					continue;
+				}
+
+				const Key h = t->size(cell.level);
+				for(Index d = 0; d < Dimension; ++d) {
+					lower[d] = t->coordinate(d,
+							cell.lower[d]);
+					upper[d] = t->coordinate(d,
+							cell.lower[d] + h);
+				}
+
+				if(split(lower, upper)) {
+					t->split(c);
+				}
+			}
+		}
+
+		t->build();
+		return AdaptiveGrid(std::move(t));
+	}
+
+	/**
+	 * @return The base grid.
+	 */
+	const RectilinearGrid<Dimension> &base() const {
+		return tree->base;
+	}
+
+	/**
+	 * @return The maximum number of times a cell of the base grid can be
+	 *         split.
+	 */
+	int levels() const {
+		return tree->levels;
+	}
+
+	/**
+	 * @return The number of leaves (cells that are not split).
+	 */
+	Index leaves() const {
+		return tree->leaves;
+	}
+
+	/**
+	 * @param index An index corresponding to a node on the grid.
+	 * @return The lattice coordinates of the node.
+	 */
+	const Point &key(Index index) const {
+		return tree->keys[index];
+	}
+
+	/**
+	 * @param key Lattice coordinates.
+	 * @return The index of the node with these lattice coordinates, or a
+	 *         negative number if there is no such node.
+	 */
+	Index index(const Point &key) const {
+		return tree->find(key);
+	}
+
+	/**
+	 * The neighbour of a node in the positive or negative direction of the
+	 * d-th axis: the closest point on that line that lies on the boundary
+	 * of a leaf adjacent to the node. If this point is not itself a node,
+	 * it is interpolated on the face of the leaf it lies on.
+	 * @param index An index corresponding to a node on the grid.
+	 * @param d The axis.
+	 * @param forward True for the positive direction.
+	 * @return The neighbour (with no nodes if the node is on the boundary).
+	 */
+	Neighbour neighbour(Index index, Index d, bool forward) const {
+		const Index k = 2 * (Dimension * index + d) + (forward ? 1 : 0);
+		const Index begin = tree->offsets[k];
+		return Neighbour {
+			tree->distances[k],
+			tree->offsets[k + 1] - begin,
+			tree->stencilNodes.data() + begin,
+			tree->stencilWeights.data() + begin
+		};
+	}
+
+	/**
+	 * Interpolates data on the nodes of the grid. In each leaf, the data
+	 * is interpolated multilinearly using the values at the corners of the
+	 * leaf. Points outside of the grid are moved to the closest point on
+	 * the grid.
+	 * @param vector Data points.
+	 * @param coordinates The coordinates.
+	 * @return Interpolated value.
+	 */
+	template <typename V>
+	Real interpolate(const V &vector,
+			const std::array<Real, Dimension> &coordinates) const {
+		const Tree &t = *tree;
+		const Real scale = t.size(0);
+
+		// Root and position relative to the lattice
+		Real u[Dimension];
+		Index c = 0, stride = 1;
+		for(Index d = 0; d < Dimension; ++d) {
+			auto data = linearInterpolationData(t.base[d],
+					coordinates[d]);
+			const Index b = std::get<0>(data);
+			u[d] = (b + 1. - std::get<1>(data)) * scale;
+			c += stride * b;
+			stride *= t.roots[d];
+		}
+
+		// Descend
+		while(t.cells[c].children >= 0) {
+			const Cell &cell = t.cells[c];
+			const Real half = t.size(cell.level + 1);
+			Index k = 0;
+			for(Index d = 0; d < Dimension; ++d) {
+				if(u[d] >= cell.lower[d] + half) {
+					k += 1 << d;
+				}
+			}
+			c = cell.children + k;
+		}
+
+		const Cell &cell = t.cells[c];
+		const Real h = t.size(cell.level);
+		Real w[Dimension];
+		for(Index d = 0; d < Dimension; ++d) {
+			w[d] = (u[d] - cell.lower[d]) / h;
+		}
+
+		const Index *corners = t.corners.data() + c * Children::value;
+		Real interpolated = 0.;
+		for(std::intmax_t k = 0; k < Children::value; ++k) {
+			Real factor = 1.;
+			for(Index d = 0; d < Dimension; ++d) {
+				factor *= ((k >> d) & 1) ? w[d] : 1. - w[d];
+			}
+
+			// See PiecewiseLinear::interpolate
+			if(factor > QuantPDE::epsilon) {
+				interpolated += factor * vector[corners[k]];
+			}
+		}
+
+		return interpolated;
+	}
+
+	/**
+	 * Prettifies and prints the grid.
+	 * @param os The output stream.
+	 * @param grid A grid.
+	 */
+	friend std::ostream &operator<<(std::ostream &os,
+			const AdaptiveGrid<Dimension> &grid) {
+		os << grid.base() << " with " << grid.leaves() << " leaves and "
+				<< grid.size() << " nodes";
+		return os;
+	}
+
+	////////////////////////////////////////////////////////////////////////
+
+	virtual std::array<Real, Dimension> coordinates(Index index) const {
+		return tree->coordinates[index];
+	}
+
+	virtual Index size() const {
+		return tree->keys.size();
+	}
+
+	virtual InterpolantFactoryWrapper<Dimension> defaultInterpolantFactory()
+			const;
+
+};
+
+typedef AdaptiveGrid<1> AdaptiveGrid1;
+typedef AdaptiveGrid<2> AdaptiveGrid2;
+typedef AdaptiveGrid<3> AdaptiveGrid3;
+
+/**
+ * A function defined piecewise on the leaves of an adaptive grid whose pieces
+ * are multilinear functions.
+ * @see QuantPDE::AdaptiveGrid::interpolate
+ */
+template <Index Dimension, typename V = Vector>
+class AdaptivePiecewiseLinear : public Interpolant<Dimension> {
+
+	typedef std::unique_ptr<Interpolant<Dimension>> I;
+	typedef std::unique_ptr<InterpolantFactory<Dimension>> F;
+	typedef InterpolantWrapper<Dimension> WI;
+
+	const AdaptiveGrid<Dimension> grid;
+	V vector;
+
+public:
+
+	virtual Real interpolate(const std::array<Real, Dimension> &coordinates)
+			const {
+		return grid.interpolate(vector, coordinates);
+	}
+
+	class Factory : public InterpolantFactory<Dimension> {
+
+		const AdaptiveGrid<Dimension> grid;
+
+	public:
+
+		/**
+		 * Constructor.
+		 */
+		Factory(const AdaptiveGrid<Dimension> &grid) noexcept :
+				grid(grid) {
+		}
+
+		/**
+		 * Copy constructor.
+		 */
+		Factory(const Factory &that) noexcept : grid(that.grid) {
+		}
+
+		Factory &operator=(const Factory &that) = delete;
+
+		virtual WI make(const Vector &vector) const {
+			return WI(I(new AdaptivePiecewiseLinear(grid, vector)));
+		}
+
+		virtual WI make(Vector &&vector) const {
+			return WI(I(new AdaptivePiecewiseLinear(grid,
+					std::move(vector))));
+		}
+
+		virtual F clone() const {
+			return F(new Factory(*this));
+		}
+
+	};
+
+	/**
+	 * Constructor.
+	 */
+	template <typename V1>
+	AdaptivePiecewiseLinear(const AdaptiveGrid<Dimension> &grid,
+			V1 &&vector) noexcept : grid(grid),
+			vector( std::forward<V1>(vector) ) {
+	}
+
+	/**
+	 * Copy constructor.
+	 */
+	AdaptivePiecewiseLinear(const AdaptivePiecewiseLinear &that) noexcept
+			: grid(that.grid), vector(that.vector) {
+	}
+
+	AdaptivePiecewiseLinear(AdaptivePiecewiseLinear &&that) = delete;
+	AdaptivePiecewiseLinear &operator=(const AdaptivePiecewiseLinear &)
+			= delete;
+
+	virtual I clone() const {
+		return I(new AdaptivePiecewiseLinear(*this));
+	}
+
+};
+
+template <Index Dimension>
+InterpolantFactoryWrapper<Dimension>
+		AdaptiveGrid<Dimension>::defaultInterpolantFactory() const {
+	return InterpolantFactoryWrapper<Dimension>(
+		std::unique_ptr<InterpolantFactory<Dimension>>(
+			new typename AdaptivePiecewiseLinear<Dimension>
+					::Factory(*this)
+		)
+	);
+}
+
+typedef AdaptivePiecewiseLinear<1> AdaptivePiecewiseLinear1;
+typedef AdaptivePiecewiseLinear<2> AdaptivePiecewiseLinear2;
+typedef AdaptivePiecewiseLinear<3> AdaptivePiecewiseLinear3;
+
+} // QuantPDE
+
+#endif
@@ -1,21 +1,40 @@
 #ifndef QUANT_PDE_CORE_AXIS_HPP
 #define QUANT_PDE_CORE_AXIS_HPP
 
+#include <algorithm>        // std::max, std::min, std::sort
 #include <cassert>          // assert
-#include <cmath>            // std::asinh, std::floor, std::sinh
+#include <cmath>            // std::abs, std::asinh, std::floor, std::round,
+                            // std::sinh, std::sqrt
 #include <cstring>          // std::memcpy
 #include <initializer_list> // std::initializer_list
 #include <iostream>         // std::ostream
+#include <vector>           // std::vector
 
 namespace QuantPDE {
 
+/**
+ * Holds the static axes of Axis. Static data members of class templates can be
+ * defined in a header included by many translation units.
+ */
+template <typename A>
+class AxisConstants {
+
+public:
+
+	/**
+	 * A hand-picked axis from 0 to 100 with 33 ticks, clustered close to 1.
+	 */
+	static A special;
+
+};
+
 /**
  * A set of monotonically increasing values used to represent a partition of an
  * interval (e.g. \f$\left\{x_i\right\}\f$, where
  * \f$a \equiv x_1 < \ldots < x_n \equiv b\f$; the \f$x_i\f$ are referred to
  * as ticks).
  */
-class Axis final {
+class Axis final : public AxisConstants<Axis> {
 
 	Index length;
 	Real *n;
@@ -257,9 +276,162 @@ public:
 	}
 
 	/**
-	 * A hand-picked axis from 0 to 100 with 33 ticks, clustered close to 1.
+	 * Creates an axis with points clustered around several features.
+	 *
+	 * The ticks are the image of a uniform partition under the inverse of
+	 * the smooth, strictly increasing map
+	 * \f$x \mapsto \sum_k \sinh^{-1}\left((x - f_k) / c_k\right)\f$, where
+	 * \f$f_k\f$ are the features and
+	 * \f$c_k = (b - a) / (2 \alpha_k)\f$ for intensities \f$\alpha_k\f$
+	 * (with a single feature in the middle of the axis, this is the
+	 * mapping used by Axis::cluster). The spacing of ticks is smallest at
+	 * the features and grows smoothly away from them.
+	 *
+	 * The first and last ticks, the features and the fixed ticks (e.g.
+	 * barriers or the initial spot) are placed exactly: the partition of
+	 * the mapped interval is adjusted so that each of these falls on a
+	 * tick.
+	 *
+	 * @param begin The first tick (inclusive).
+	 * @param end The last tick (inclusive).
+	 * @param points The total number of points (more are used if there are
+	 *               more exact ticks than points).
+	 * @param features The points to cluster around.
+	 * @param intensities Controls the fraction of points that lie around
+	 *                    each feature (if empty, 1 is used for each
+	 *                    feature).
+	 * @param fixed Other ticks to place exactly.
+	 * @return An axis.
 	 */
-	static Axis special;
+	static Axis multiCluster(
+		Real begin,
+		Real end,
+		Index points,
+		const std::vector<Real> &features,
+		const std::vector<Real> &intensities = std::vector<Real>(),
+		const std::vector<Real> &fixed = std::vector<Real>()
+	) {
+		assert(begin < end);
+		assert(!features.empty());
+		assert(intensities.empty()
+				|| intensities.size() == features.size());
+
+		const Index m = features.size();
+		std::vector<Real> c(m);
+		for(Index k = 0; k < m; ++k) {
+			const Real intensity = intensities.empty() ? 1.
+					: intensities[k];
+			assert(intensity > 0.);
+			c[k] = (end - begin) / (2. * intensity);
+		}
+
+		// Mapping and its derivative
+		auto F = [&] (Real x) {
+			Real y = 0.;
+			for(Index k = 0; k < m; ++k) {
+				y += std::asinh((x - features[k]) / c[k]);
+			}
+			return y;
+		};
+		auto dF = [&] (Real x) {
+			Real y = 0.;
+			for(Index k = 0; k < m; ++k) {
+				const Real z = x - features[k];
+				y += 1. / std::sqrt(c[k] * c[k] + z * z);
+			}
+			return y;
+		};
+
+		// Ticks that must be placed exactly
+		std::vector<Real> exact(features);
+		exact.insert(exact.end(), fixed.begin(), fixed.end());
+		std::sort(exact.begin(), exact.end());
+		std::vector<Real> breaks { begin };
+		for(Real x : exact) {
+			if(x > breaks.back() && x < end) {
+				breaks.push_back(x);
+			}
+		}
+		breaks.push_back(end);
+
+		// Index of the tick at each break (strictly increasing)
+		const Index segments = breaks.size() - 1;
+		const Index intervals = std::max<Index>(points - 1, segments);
+		const Real y0 = F(begin), y1 = F(end);
+		std::vector<Index> at(segments + 1);
+		at[0] = 0;
+		at[segments] = intervals;
+		for(Index s = 1; s < segments; ++s) {
+			Index i = std::round( (F(breaks[s]) - y0) / (y1 - y0)
+					* intervals );
+			i = std::max<Index>(i, at[s - 1] + 1);
+			i = std::min<Index>(i, intervals - (segments - s));
+			at[s] = i;
+		}
+
+		// Mapped breaks and the slopes of the monotone (Fritsch-Carlson)
+		// cubic interpolating them as a function of the tick index; this
+		// keeps the spacing of ticks smooth across the breaks
+		std::vector<Real> y(segments + 1), slope(segments + 1);
+		for(Index s = 0; s <= segments; ++s) {
+			y[s] = F(breaks[s]);
+		}
+		auto secant = [&] (Index s) {
+			return (y[s + 1] - y[s]) / (at[s + 1] - at[s]);
+		};
+		slope[0] = secant(0);
+		slope[segments] = secant(segments - 1);
+		for(Index s = 1; s < segments; ++s) {
+			const Real h0 = at[s] - at[s - 1], h1 = at[s + 1] - at[s];
+			const Real w0 = 2. * h1 + h0, w1 = h1 + 2. * h0;
+			slope[s] = (w0 + w1) / (w0 / secant(s - 1)
+					+ w1 / secant(s));
+		}
+
+		Axis axis(intervals + 1);
+		for(Index s = 0; s < segments; ++s) {
+			const Real a = breaks[s], b = breaks[s + 1];
+			const Index n = at[s + 1] - at[s];
+
+			axis.n[at[s]] = a;
+			for(Index j = 1; j < n; ++j) {
+				// Hermite cubic
+				const Real t = (Real) j / n;
+				const Real target =
+					(2*t*t*t - 3*t*t + 1) * y[s]
+					+ (t*t*t - 2*t*t + t) * n * slope[s]
+					+ (-2*t*t*t + 3*t*t) * y[s + 1]
+					+ (t*t*t - t*t) * n * slope[s + 1]
+				;
+
+				// Safeguarded Newton's method on [lo, hi]
+				Real lo = a, hi = b, x = (a + b) / 2.;
+				for(int it = 0; it < 100; ++it) {
+					const Real r = F(x) - target;
+					if(r > 0.) {
+						hi = x;
+					} else {
+						lo = x;
+					}
+					Real next = x - r / dF(x);
+					if(!(next > lo && next < hi)) {
+						next = (lo + hi) / 2.;
+					}
+					if(std::abs(next - x) <= epsilon
+							* (end - begin)) {
+						x = next;
+						break;
+					}
+					x = next;
+				}
+
+				axis.n[at[s] + j] = x;
+			}
+		}
+		axis.n[intervals] = end;
+
+		return axis;
+	}
 
 	/**
 	 * Union of two axes.
@@ -442,7 +614,8 @@ public:
 
 };
 
-Axis Axis::special {
+template <typename A>
+A AxisConstants<A>::special {
 	0., .1, .2, .3, .4, .5, .6, .7,
 	/*.75,*/ .80,
 	.84, .88, .92,
@@ -463,7 +636,7 @@ Axis Axis::special {
  * @param os The output stream.
  * @param axis The axis.
  */
-std::ostream &operator<<(std::ostream &os, const Axis &axis) {
+inline std::ostream &operator<<(std::ostream &os, const Axis &axis) {
 	os << axis[0];
 	for(Index i = 1; i < axis.size(); ++i) {
 		os << ' ' << axis[i];
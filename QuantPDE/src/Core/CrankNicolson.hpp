@@ -69,12 +69,10 @@ class CrankNicolson : public IterationNode {
 		// TODO: Optimize for explicit method
 
 		// Make sure this is called first
-		auto A = system.A(t0);
+		const Vector Av0 = system.Ax(t0, v0);
 
-		return (
-			this->domain.identity()
-			- A * (1-theta) * dt()
-		) * v0 + ( theta * system.b(t1) + (1-theta) * system.b(t0) );
+		return v0 - Av0 * ((1-theta) * dt())
+				+ ( theta * system.b(t1) + (1-theta) * system.b(t0) );
 	}
 
 public:
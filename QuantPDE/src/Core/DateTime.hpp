@@ -194,7 +194,7 @@ public:
 /**
  * @return The difference between the two times, in years.
  */
-Real operator-(const DateTime &a, const DateTime &b) {
+inline Real operator-(const DateTime &a, const DateTime &b) {
 	return (double) (a.timestamp() - b.timestamp()) / 60. / 60. / 24.
 			/ 365. ;
 }
@@ -202,14 +202,14 @@ Real operator-(const DateTime &a, const DateTime &b) {
 /**
  * @return True if and only if the two objects point to the same date-time.
  */
-bool operator==(const DateTime &a, const DateTime &b) {
+inline bool operator==(const DateTime &a, const DateTime &b) {
 	return a.timestamp() == b.timestamp();
 }
 
 /**
  * @see QuantPDE::DateTime::operator==
  */
-bool operator!=(const DateTime &a, const DateTime &b) {
+inline bool operator!=(const DateTime &a, const DateTime &b) {
 	return a.timestamp() != b.timestamp();
 }
 
@@ -217,7 +217,7 @@ bool operator!=(const DateTime &a, const DateTime &b) {
  * @return True if and only if the first argument points to an earlier date than
  *         the second.
  */
-bool operator<(const DateTime &a, const DateTime &b) {
+inline bool operator<(const DateTime &a, const DateTime &b) {
 	return a.timestamp() < b.timestamp();
 }
 
@@ -225,7 +225,7 @@ bool operator<(const DateTime &a, const DateTime &b) {
  * @see QuantPDE::DateTime::operator<
  * @see QuantPDE::DateTime::operator==
  */
-bool operator>(const DateTime &a, const DateTime &b) {
+inline bool operator>(const DateTime &a, const DateTime &b) {
 	return a.timestamp() > b.timestamp();
 }
 
@@ -233,7 +233,7 @@ bool operator>(const DateTime &a, const DateTime &b) {
  * @see QuantPDE::DateTime::operator<
  * @see QuantPDE::DateTime::operator==
  */
-bool operator<=(const DateTime &a, const DateTime &b) {
+inline bool operator<=(const DateTime &a, const DateTime &b) {
 	return a.timestamp() <= b.timestamp();
 }
 
@@ -241,7 +241,7 @@ bool operator<=(const DateTime &a, const DateTime &b) {
  * @see QuantPDE::DateTime::operator<
  * @see QuantPDE::DateTime::operator==
  */
-bool operator>=(const DateTime &a, const DateTime &b) {
+inline bool operator>=(const DateTime &a, const DateTime &b) {
 	return a.timestamp() >= b.timestamp();
 }
 
@@ -6,8 +6,10 @@
 #include <cstdlib>     // size_t
 #include <iostream>    // std::ostream
 #include <iomanip>     // std::setw
+#include <limits>      // std::numeric_limits
 #include <memory>      // std::shared_ptr, std::unique_ptr
-#include <type_traits> // std::conditional, std::enable_if, std::is_same
+#include <type_traits> // std::conditional, std::enable_if, std::is_base_of,
+                       // std::is_same
 #include <utility>     // std::forward, std::move
 
 namespace QuantPDE {
@@ -46,26 +48,39 @@ public:
 	/**
 	 * @return A zero vector of length equal to the number of nodes on this
 	 *         domain.
+	 * @see QuantPDE::setFirstTouch
 	 */
 	Vector zero() const {
-		return Vector::Zero(size());
+		Vector v(size());
+		fill(v, 0.);
+		return v;
 	}
 
 	/**
 	 * @return A vector of ones of length equal to the number of nodes on
 	 *         this domain.
+	 * @see QuantPDE::setFirstTouch
 	 */
 	Vector ones() const {
-		return Vector::Ones(size());
+		Vector v(size());
+		fill(v, 1.);
+		return v;
 	}
 
 	/**
 	 * @return A vector of length equal to the number of nodes on this
 	 *         domain. No guarantees are made on the contents of this
-	 *         vector.
+	 *         vector (when first touch is enabled and the vector is large
+	 *         enough to be split between threads, it is written to in
+	 *         parallel).
+	 * @see QuantPDE::setFirstTouch
 	 */
 	Vector vector() const {
-		return Vector(size());
+		Vector v(size());
+		if(parallelFirstTouch() && multiplyBlocks(v.size()) > 1) {
+			fill(v, 0.);
+		}
+		return v;
 	}
 
 	/**
@@ -94,7 +109,12 @@ class Domain : public DomainBase {
 
 	public:
 
-		template <typename D>
+		template <
+			typename D,
+			typename = typename std::enable_if<
+				std::is_base_of<Domain, D>::value
+			>::type
+		>
 		Iterator(D &domain, Index index = 0) noexcept : domain(&domain),
 				index(index) {
 		}
@@ -557,6 +577,25 @@ QUANT_PDE_TMP(NON_CONST)
 template <Index Dimension> template <typename F>
 Vector Domain<Dimension>::image(F &&function) const {
 	Vector v = vector();
+
+	// Batch functions are evaluated in place on blocks of coordinates (in
+	// parallel; batch callables are required to be thread-safe)
+	const BatchFunction1 *batch = batchFunction(function);
+	if(Dimension == 1 && batch) {
+		const Index n = v.size();
+		const Index count = multiplyBlocks(n);
+		parallelBlocks(count, [&] (Index k) {
+			const Index first = (n * k) / count;
+			const Index last  = (n * (k + 1)) / count;
+			Real *x = v.data() + first;
+			for(Index i = first; i < last; ++i) {
+				x[i - first] = coordinates(i)[0];
+			}
+			batch->evaluate(x, x, last - first);
+		});
+		return v;
+	}
+
 	for(auto node : accessor(*this, v)) {
 		*node = packAndCall<Dimension>(
 			std::forward<F>(function),
@@ -1018,6 +1057,15 @@ class RectilinearGrid : public Domain<Dimension> {
 		// TODO: Optimize (loop unroll)
 		for(Index i = 0; i < Dimension; ++i) {
 			assert(this->axes[i].size() > 0);
+
+			// Make sure the number of nodes is representable (see
+			// QUANT_PDE_64BIT_INDEX)
+			if(vsize > std::numeric_limits<Index>::max()
+					/ this->axes[i].size()) {
+				throw "error: the number of nodes does not fit in "
+						"the index type";
+			}
+
 			vsize *= this->axes[i].size();
 		}
 	}
@@ -1124,13 +1172,22 @@ public:
 			}
 
 			// 2^(t - 1)
-			int tmp = 2;
+			Index tmp = 2;
 			for(int i = 1; i < times; ++i) {
+				if(tmp > std::numeric_limits<Index>::max() / 2) {
+					throw "error: the refined axis does not fit "
+							"in the index type";
+				}
 				tmp *= 2;
 			}
 
 			// Create axis; size 2^t * |n| - 2^(t-1)
-			const int size = tmp * (n.size() - 1) + 1;
+			if(n.size() - 1 > (std::numeric_limits<Index>::max() - 1)
+					/ tmp) {
+				throw "error: the refined axis does not fit in the "
+						"index type";
+			}
+			const Index size = tmp * (n.size() - 1) + 1;
 			m = Axis(size);
 
 			// Write nodes
@@ -1163,8 +1220,7 @@ public:
 			|| TypePackIsT<const Axis &, Ts...>::value
 		>::type
 	>
-	RectilinearGrid(Ts &&...axes) noexcept
-			: axes { std::forward<Ts>(axes)... } {
+	RectilinearGrid(Ts &&...axes) : axes { std::forward<Ts>(axes)... } {
 		static_assert(Dimension == sizeof...(Ts),
 				"The number of arguments must be consistent "
 				"with the dimensions");
@@ -1476,7 +1532,7 @@ public:
 		for(Index i = Dimension - 1; i > 0; i--) {
 			array[i] = index / m;
 			index -= array[i] * m;
-			m /= axes[i].size();
+			m /= axes[i - 1].size();
 		}
 		array[0] = index;
 
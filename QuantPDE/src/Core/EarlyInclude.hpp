@@ -45,8 +45,8 @@ namespace QuantPDE {
 	typedef double Real;
 	#endif
 
-	Real max(Real x, Real y) { return x > y ? x : y; }
-	Real min(Real x, Real y) { return x < y ? x : y; }
+	inline Real max(Real x, Real y) { return x > y ? x : y; }
+	inline Real min(Real x, Real y) { return x < y ? x : y; }
 
 	template <typename T>
 	struct ToleranceScalar {
@@ -1,9 +1,12 @@
 #ifndef QUANT_PDE_CORE_EVENT_HPP
 #define QUANT_PDE_CORE_EVENT_HPP
 
+#include <cassert>    // assert
 #include <functional> // std::function
 #include <memory>     // std::unique_ptr
+#include <tuple>      // std::get
 #include <utility>    // std::forward, std::move
+#include <vector>     // std::vector
 
 namespace QuantPDE {
 
@@ -33,6 +36,11 @@ class EventBase {
 	virtual Vector doEvent(const Vector &vector) const = 0;
 	virtual Vector doEvent(Vector &&vector) const = 0;
 
+	virtual void doEventInPlace(Vector &vector) const {
+		// Default: move the vector in and the result back out
+		vector = doEvent( std::move(vector) );
+	}
+
 public:
 
 	template <typename V>
@@ -40,6 +48,16 @@ public:
 		return doEvent( std::forward<V>(vector) );
 	}
 
+	/**
+	 * Transforms a vector in place. Events that do not need a copy of the
+	 * vector (e.g. QuantPDE::NullEvent and QuantPDE::DoEvent) do not
+	 * allocate.
+	 * @param vector The vector.
+	 */
+	void apply(Vector &vector) const {
+		doEventInPlace(vector);
+	}
+
 };
 
 /**
@@ -141,19 +159,19 @@ public:
 	}
 
 	/**
-	 * Default constructor for rectilinear grids.
+	 * Default constructor for domains (e.g. rectilinear or adaptive grids).
 	 * @param transform A function that transforms the solution.
-	 * @param grid A rectilinear grid.
+	 * @param domain A domain.
 	 */
 	template <typename T>
 	Event(
 		T &&transform,
-		const RectilinearGrid<Dimension> &grid
+		const Domain<Dimension> &domain
 	) noexcept :
 		transform(std::forward<T>(transform)),
-		in(grid.defaultInterpolantFactory()),
+		in(domain.defaultInterpolantFactory()),
 		out( std::unique_ptr<Map<Dimension>>(
-				new PointwiseMap<Dimension>(grid)) )
+				new PointwiseMap<Dimension>(domain)) )
 	{
 	}
 
@@ -187,6 +205,106 @@ typedef Event<1> Event1;
 typedef Event<2> Event2;
 typedef Event<3> Event3;
 
+/**
+ * An event that updates an auxiliary state variable (e.g. the running average
+ * of an Asian option, the high-water mark of a lookback or the benefit base of
+ * a withdrawal guarantee) that is one of the axes of a rectilinear grid. The
+ * solution after the event is
+ * \f$V\left(x, a\right) \mapsto V\left(x, f\left(x, a\right)\right)\f$,
+ * where \f$a\f$ is the auxiliary variable, \f$x\f$ are the remaining
+ * coordinates, and the solution is linearly interpolated along the auxiliary
+ * axis only.
+ *
+ * For example, the running maximum of a lookback option monitored
+ * discretely is updated by
+ * \code{.cpp}
+ * AuxiliaryEvent2 event(grid, [] (Real S, Real M) { return max(S, M); } );
+ * \endcode
+ *
+ * Since the updated coordinates do not depend on the solution, the
+ * interpolation weights are computed once (on construction). The grid splits
+ * into one-dimensional slices along the auxiliary axis that are independent of
+ * each other; the event is applied to the slices in parallel. More general
+ * transformations should use Event.
+ *
+ * @tparam AIndex The index of the auxiliary axis.
+ */
+template <Index Dimension, Index AIndex>
+class AuxiliaryEvent : public EventBase {
+
+	static_assert(AIndex >= 0 && AIndex < Dimension,
+			"The auxiliary index must be between 0 (inclusive) and "
+			"Dimension (exclusive)");
+
+	Index n, stride, slices;
+
+	// For each node, the tick to the left of the updated auxiliary
+	// coordinate and its weight
+	std::vector<Index> ticks;
+	std::vector<Real> weights;
+
+	template <typename V>
+	Vector _doEvent(V &&vector) const {
+		assert(vector.size() == (Index) ticks.size());
+
+		Vector result(vector.size());
+		parallelFor(0, slices, [&] (Index s) {
+			const Index base = (s % stride) + (s / stride) * stride
+					* n;
+			for(Index a = 0; a < n; ++a) {
+				const Index idx = base + a * stride;
+				const Index left = base + ticks[idx] * stride;
+				const Real w = weights[idx];
+				result(idx) = w * vector(left)
+						+ (1. - w) * vector(left + stride);
+			}
+		});
+
+		return result;
+	}
+
+	virtual Vector doEvent(const Vector &vector) const {
+		return _doEvent(vector);
+	}
+
+	virtual Vector doEvent(Vector &&vector) const {
+		return _doEvent(vector);
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param grid The grid.
+	 * @param update Takes the coordinates of a node and returns the
+	 *               updated auxiliary coordinate.
+	 */
+	template <typename F>
+	AuxiliaryEvent(const RectilinearGrid<Dimension> &grid, F &&update)
+			: n(grid[AIndex].size()), stride(1),
+			ticks(grid.size()), weights(grid.size()) {
+		assert(n >= 2);
+
+		for(Index d = 0; d < AIndex; ++d) {
+			stride *= grid[d].size();
+		}
+		slices = grid.size() / n;
+
+		for(Index idx = 0; idx < grid.size(); ++idx) {
+			const auto coordinates = grid.coordinates(idx);
+			const auto data = linearInterpolationData(
+					grid[AIndex], packAndCall<Dimension>(
+					update, coordinates.data()));
+			ticks[idx] = std::get<0>(data);
+			weights[idx] = std::get<1>(data);
+		}
+	}
+
+};
+
+typedef AuxiliaryEvent<2, 1> AuxiliaryEvent2;
+typedef AuxiliaryEvent<3, 2> AuxiliaryEvent3;
+
 /**
  * The null event returns the original vector (no transformation occurs).
  */
@@ -197,7 +315,10 @@ class NullEvent : public EventBase {
 	}
 
 	virtual Vector doEvent(Vector &&vector) const {
-		return vector;
+		return std::move(vector);
+	}
+
+	virtual void doEventInPlace(Vector &) const {
 	}
 
 };
@@ -217,7 +338,11 @@ class DoEvent : public EventBase {
 
 	virtual Vector doEvent(Vector &&vector) const {
 		onCall(vector);
-		return vector;
+		return std::move(vector);
+	}
+
+	virtual void doEventInPlace(Vector &vector) const {
+		onCall(vector);
 	}
 
 };
@@ -1,7 +1,9 @@
 #ifndef QUANT_PDE_CORE_FUNCTION_HPP
 #define QUANT_PDE_CORE_FUNCTION_HPP
 
+#include <cstdlib>    // size_t
 #include <functional> // std::function
+#include <utility>    // std::forward
 
 namespace QuantPDE {
 
@@ -19,6 +21,113 @@ typedef std::function< NRealToReal<4> > Function4;
 template <unsigned N>
 using Function = std::function< NRealToReal<N> >;
 
+/**
+ * A function of one variable that can also be evaluated at many points at once
+ * (e.g. a payoff evaluated at each node of a grid). The batch form is a loop
+ * over contiguous arrays that the compiler can vectorize, instead of one call
+ * through a std::function per point.
+ *
+ * Since this is an ordinary (copyable) function object, it can be stored in a
+ * Function1; QuantPDE::Domain::image recovers the batch form from there.
+ * \code{.cpp}
+ * BatchFunction1 f(
+ * 	[] (Real x) { return 2. * x; },
+ * 	[] (const Real *x, Real *y, size_t n) {
+ * 		for(size_t i = 0; i < n; ++i) {
+ * 			y[i] = 2. * x[i];
+ * 		}
+ * 	}
+ * );
+ * Vector v = grid.image(f);
+ * \endcode
+ * @see QuantPDE::Modules::callPayoff
+ */
+class BatchFunction1 final {
+
+	typedef std::function<void (const Real *, Real *, size_t)> B;
+
+	Function1 pointwise;
+	B batch;
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param pointwise Evaluates the function at a point.
+	 * @param batch Evaluates the function at n points: batch(x, y, n)
+	 *              sets y[i] to the value at x[i]. The arrays x and y may
+	 *              be the same (but must not otherwise overlap). It must
+	 *              be thread-safe: QuantPDE::Domain::image calls it on
+	 *              disjoint blocks of points from several threads at once
+	 *              (so it should not modify captured state).
+	 */
+	template <typename F1, typename F2>
+	BatchFunction1(F1 &&pointwise, F2 &&batch) noexcept
+			: pointwise( std::forward<F1>(pointwise) ),
+			batch( std::forward<F2>(batch) ) {
+	}
+
+	/**
+	 * @param kernel Evaluates the function at a point; it should be cheap
+	 *               enough to be inlined into the batch loop, and must be
+	 *               thread-safe (see the constructor).
+	 * @return A batch function that applies the kernel to each point.
+	 */
+	template <typename F>
+	static BatchFunction1 elementwise(F kernel) {
+		return BatchFunction1(kernel, [kernel] (const Real *x, Real *y,
+				size_t n) {
+			for(size_t i = 0; i < n; ++i) {
+				y[i] = kernel(x[i]);
+			}
+		});
+	}
+
+	/**
+	 * @param x A point.
+	 * @return The value of the function at the point.
+	 */
+	Real operator()(Real x) const {
+		return pointwise(x);
+	}
+
+	/**
+	 * Evaluates the function at many points.
+	 * @param x The points.
+	 * @param y The values (may be the same array as the points).
+	 * @param n The number of points.
+	 */
+	void evaluate(const Real *x, Real *y, size_t n) const {
+		batch(x, y, n);
+	}
+
+};
+
+/**
+ * @return Null; the function has no batch form.
+ */
+template <typename F>
+inline const BatchFunction1 *batchFunction(const F &) {
+	return nullptr;
+}
+
+/**
+ * @param function A batch function.
+ * @return The function itself.
+ */
+inline const BatchFunction1 *batchFunction(const BatchFunction1 &function) {
+	return &function;
+}
+
+/**
+ * @param function A function.
+ * @return The batch function stored in the function, or null if it holds
+ *         something else.
+ */
+inline const BatchFunction1 *batchFunction(const Function1 &function) {
+	return function.target<BatchFunction1>();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #define QUANT_PDE_TMP ( std::forward<F>(function) )( array[Indices]... )
@@ -86,7 +86,7 @@ public:
 
 	virtual Matrix A(Real t) {
 		Matrix M = grid.matrix();
-		M.reserve(IntegerVector::Constant(
+		M.reserve(nonzerosPerRow(
 			grid.size(),
 			TwoToTheDimension::value
 		));
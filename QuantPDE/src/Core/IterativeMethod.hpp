@@ -1,11 +1,11 @@
 #ifndef QUANT_PDE_CORE_ITERATIVE_METHOD_HPP
 #define QUANT_PDE_CORE_ITERATIVE_METHOD_HPP
 
+#include <algorithm>     // std::sort, std::stable_sort
 #include <array>         // std::array
 #include <cstdlib>       // std::abs, size_t
 #include <list>          // std::list
 #include <memory>        // std::shared_ptr, std::unique_ptr
-#include <queue>         // std::priority_queue
 #include <tuple>         // std::tuple
 #include <unordered_map> // std::unordered_map
 #include <utility>       // std::forward, std::move
@@ -103,6 +103,18 @@ public:
 		return data[position];
 	}
 
+	/**
+	 * Retrieves an element from the buffer given an index.
+	 * @param index The index.
+	 * @return The element.
+	 * @see QuantPDE::CircularBuffer::operator[](int) const
+	 */
+	T &operator[](int index) {
+		return const_cast<T &>(
+			static_cast<const CircularBuffer &>(*this)[index]
+		);
+	}
+
 	/**
 	 * @return The maximum number of iterands one can store in this buffer.
 	 */
@@ -110,6 +122,18 @@ public:
 		return n;
 	}
 
+	/**
+	 * Calls a function on each slot of the buffer (including slots that
+	 * were not pushed into since the last clear).
+	 * @param function The function.
+	 */
+	template <typename F>
+	void forEach(F &&function) const {
+		for(int i = 0; i < n; ++i) {
+			function(data[i]);
+		}
+	}
+
 };
 
 class Iteration;
@@ -155,6 +179,19 @@ public:
 	 */
 	virtual Vector b(Real time) = 0;
 
+	/**
+	 * Systems that can compute this product without assembling the
+	 * left-hand-side matrix (e.g. from a StencilMatrix) should override
+	 * this.
+	 * @param time The time.
+	 * @param x A vector.
+	 * @return The product of the left-hand-side matrix (A) with x.
+	 * @see QuantPDE::LinearSystem::A
+	 */
+	virtual Vector Ax(Real time, const Vector &x) {
+		return multiply(A(time), x);
+	}
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -847,6 +884,16 @@ public:
 	 */
 	virtual void setIteration(Iteration &iteration);
 
+	/**
+	 * @return The number of bytes held by this node (not including the
+	 *         linear systems it refers to or the iterands).
+	 * @see QuantPDE::Iteration::memoryReport
+	 */
+	virtual size_t memoryUsage() const {
+		// Default: nothing
+		return 0;
+	}
+
 	friend Iteration;
 
 };
@@ -914,6 +961,35 @@ private:
 				this->iterand(0)
 			)
 		));
+
+		sampleMemory(solver);
+	}
+
+	// Updates the memory report of the outermost iterative method
+	void sampleMemory(const LinearSolver &solver) {
+		Iteration *outer = outermost ? outermost : this;
+		MemoryReport &memory = outer->memory;
+
+		memory.history = 0;
+		memory.nodes = 0;
+		memory.nodeUsage.clear();
+		for(Iteration *i = outer; i; i = i->child) {
+			if(i->history) {
+				i->history->forEach([&] (const std::tuple<Real,
+						Vector> &entry) {
+					memory.history += sizeof(Real)
+						+ QuantPDE::memoryUsage(
+						std::get<1>(entry));
+				});
+			}
+			for(auto node : i->nodes) {
+				const size_t bytes = node->memoryUsage();
+				memory.nodeUsage.emplace_back(node, bytes);
+				memory.nodes += bytes;
+			}
+		}
+		memory.solver = solver.memoryUsage();
+		memory.sample();
 	}
 
 	virtual bool isTimestepTheSame() const = 0;
@@ -928,6 +1004,9 @@ private:
 protected:
 
 	Iteration *child;
+	Iteration *outermost;
+	ExecutionContext *context;
+	MemoryReport memory;
 	std::list<IterationNode *> nodes;
 	CB *history;
 	Real implicitTime;
@@ -957,7 +1036,8 @@ public:
 	/**
 	 * Constructor.
 	 */
-	Iteration() noexcept : child(nullptr), history(nullptr),
+	Iteration() noexcept : child(nullptr), outermost(nullptr),
+			context(nullptr), history(nullptr),
 		// Initialize implicit time to some infeasible value
 		implicitTime(-1.) {
 	}
@@ -978,6 +1058,16 @@ public:
 		child = &innerIteration;
 	}
 
+	/**
+	 * Sets the execution context used by the parallel loops run while
+	 * solving (instead of the global context).
+	 * @param context An execution context.
+	 * @see QuantPDE::ExecutionContext
+	 */
+	void setExecutionContext(ExecutionContext &context) {
+		this->context = &context;
+	}
+
 	// Disable copy constructor and assignment operator.
 	Iteration(const Iteration &) = delete;
 	Iteration &operator=(const Iteration &) = delete;
@@ -998,6 +1088,14 @@ public:
 		return its;
 	}
 
+	/**
+	 * @return The memory used by the last solve (of this iterative method
+	 *         and the inner ones).
+	 */
+	const MemoryReport &memoryReport() const {
+		return memory;
+	}
+
 	/**
 	 * @param map Maps the initial condition to the domain nodes.
 	 * @param factory Interpolates the solution on the domain nodes to the
@@ -1017,9 +1115,15 @@ public:
 		IterationNode &root,
 		LinearSolver &solver
 	) {
+		ExecutionContext::Scope scope(context);
+
+		memory = MemoryReport();
+
 		// Clear iteration count
 		Iteration *current = this;
 		do {
+			current->outermost = this;
+
 			// Initialize history
 			int lookback = current->minimumLookback();
 			for(auto node : current->nodes) {
@@ -1039,17 +1143,19 @@ public:
 			current = current->child;
 		} while(current);
 
-		// Map, iterate, interpolate
+		// Map, iterate
+		Vector solution = iterateUntilDone(
+			map(std::forward<F>(initialCondition)),
+			root,
+			solver,
+			-1., // Use a time value that is bogus
+			false
+		);
+		memory.peakResident = peakResidentMemory();
+
+		// Interpolate
 		return InterpolantWrapper<Dimension>(
-			factory.make(
-				iterateUntilDone(
-					map(std::forward<F>(initialCondition)),
-					root,
-					solver,
-					-1., // Use a time value that is bogus
-					false
-				)
-			)
+			factory.make( std::move(solution) )
 		);
 	}
 
@@ -1086,7 +1192,7 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void IterationNode::setIteration(Iteration &iteration) {
+inline void IterationNode::setIteration(Iteration &iteration) {
 	if(this->iteration) {
 		this->iteration->nodes.remove(this);
 	}
@@ -1262,36 +1368,40 @@ public:
 		dt = -1.; \
 	} while(0)
 
-// Copy the priority queue so this iteration can be used again in the future
-// and add the NullEvent so as to make sure that iteration terminates
+// Walk the (sorted) schedule with a cursor so that this iteration can be used
+// again in the future; once the schedule is exhausted, step to the terminal time
 #undef QUANT_PDE_TMP_OUTER_HEAD
 #define QUANT_PDE_TMP_OUTER_HEAD \
-	PriorityQueue events(this->events); \
-	events.emplace( \
-		std::numeric_limits<unsigned>::max(), \
-		terminalTime(), \
-		std::shared_ptr<EventBase>(new NullEvent{}) \
-	); \
+	sortEvents(); \
+	size_t next = 0, nextSnapshot = 0; \
 	do { \
-		const Real nextEventTime = std::get<1>(events.top());
+		const Real nextEventTime = upcomingTime(next, nextSnapshot);
 
+// Snapshots see the most recent iterand before the events transform it (in
+// place)
 #undef QUANT_PDE_TMP_OUTER_TAIL
 #define QUANT_PDE_TMP_OUTER_TAIL \
 		this->implicitTime = nextEventTime; \
-		const Vector *current = &this->iterand(0); \
-		Vector transformed; \
-		while(!events.empty() && std::get<1>(events.top()) \
+		while(nextSnapshot < snapshots.size() && std::get<0>( \
+				snapshots[nextSnapshot]) == this->implicitTime) { \
+			std::get<1>(snapshots[nextSnapshot++])->write( \
+					this->implicitTime, this->iterand(0)); \
+		} \
+		if(next < events.size() && std::get<1>(events[next]) \
 				== this->implicitTime) { \
-			transformed = (*std::get<2>(events.top()))(*current); \
-			events.pop(); \
-			current = &transformed; \
+			Vector transformed = std::move( std::get<1>( \
+					(*this->history)[0] ) ); \
+			do { \
+				std::get<2>(events[next++])->apply(transformed); \
+			} while(next < events.size() && std::get<1>(events[next]) \
+					== this->implicitTime); \
+			this->afterEvent(); \
+			this->history->clear(); \
+			this->history->push(std::make_tuple( \
+				this->implicitTime, \
+				std::move(transformed) \
+			)); \
 		} \
-		this->afterEvent(); \
-		this->history->clear(); \
-		this->history->push(std::make_tuple( \
-			this->implicitTime, \
-			std::move(transformed) \
-		)); \
 	} while( Order()(terminalTime(), this->implicitTime) )
 
 // TODO: Optimize
@@ -1355,7 +1465,38 @@ class TimeIteration : public Iteration {
 	// order they were added. Events added later are assumed to occur later
 	// in time (e.g. handled earlier if Forward == true; later otherwise).
 
-	typedef std::priority_queue<T, std::vector<T>, TimeOrder> PriorityQueue;
+	// Sorts the events in the order they are handled (the reverse of
+	// TimeOrder) and the snapshots by time, if any were added since the
+	// last sort
+	void sortEvents() {
+		if(sorted) {
+			return;
+		}
+		std::sort(events.begin(), events.end(), [] (const T &a,
+				const T &b) {
+			return TimeOrder()(b, a);
+		});
+		std::stable_sort(snapshots.begin(), snapshots.end(),
+				[] (const S &a, const S &b) {
+			return Order()( std::get<0>(b), std::get<0>(a) );
+		});
+		sorted = true;
+	}
+
+	// The first time at which an event occurs or a snapshot is taken (or
+	// the terminal time if there are none left)
+	Real upcomingTime(size_t next, size_t nextSnapshot) const {
+		Real time = terminalTime();
+		if(next < events.size() && Order()(time,
+				std::get<1>(events[next]))) {
+			time = std::get<1>(events[next]);
+		}
+		if(nextSnapshot < snapshots.size() && Order()(time,
+				std::get<0>(snapshots[nextSnapshot]))) {
+			time = std::get<0>(snapshots[nextSnapshot]);
+		}
+		return time;
+	}
 
 	////////////////////////////////////////////////////////////////////////
 
@@ -1383,8 +1524,12 @@ class TimeIteration : public Iteration {
 
 	////////////////////////////////////////////////////////////////////////
 
+	typedef std::tuple<Real, SnapshotSink *> S;
+
 	unsigned id;
-	PriorityQueue events;
+	std::vector<T> events;
+	std::vector<S> snapshots;
+	bool sorted;
 
 	Real startTime, endTime, dt, dtPrevious;
 
@@ -1400,7 +1545,7 @@ public:
 	 * Constructor.
 	 */
 	TimeIteration(Real startTime, Real endTime) noexcept : id(0),
-			startTime(startTime), endTime(endTime),
+			sorted(true), startTime(startTime), endTime(endTime),
 			// Initialize dt to some infeasible value
 			dt(-1.), dtPrevious(-1.) {
 		assert(startTime >= 0.);
@@ -1417,7 +1562,42 @@ public:
 		assert(time <= endTime);
 		assert(time != initialTime());
 
-		events.emplace( id++, time, std::move(event) );
+		events.emplace_back( id++, time, std::move(event) );
+		sorted = false;
+	}
+
+	/**
+	 * Requests the solution at a time. When the time iteration reaches
+	 * the time (before handling the events at that time), the sink
+	 * receives a view of the solution; no copy is made. Timesteps are
+	 * shortened to land on the time (as for events).
+	 * @param time The time.
+	 * @param sink Receives the solution at each solve.
+	 * @see QuantPDE::MappedSnapshotWriter
+	 */
+	void snapshot(Real time, SnapshotSink &sink) {
+		assert(time >= startTime);
+		assert(time <= endTime);
+		assert(time != initialTime());
+
+		snapshots.emplace_back(time, &sink);
+		sorted = false;
+	}
+
+	/**
+	 * Adds an event to be processed. The same event may be added at
+	 * several times (e.g. an event that reads the time from
+	 * QuantPDE::Iteration::nextTime).
+	 * @param time The time at which the event occurs.
+	 * @param event The event.
+	 */
+	void add(Real time, std::shared_ptr<EventBase> event) {
+		assert(time >= startTime);
+		assert(time <= endTime);
+		assert(time != initialTime());
+
+		events.emplace_back( id++, time, std::move(event) );
+		sorted = false;
 	}
 
 	/**
@@ -1432,7 +1612,7 @@ public:
 		assert(time <= endTime);
 		assert(time != initialTime());
 
-		events.emplace(
+		events.emplace_back(
 			id++,
 			time,
 			std::shared_ptr<EventBase>(
@@ -1441,6 +1621,7 @@ public:
 				)
 			)
 		);
+		sorted = false;
 	}
 
 	// TODO: Trying to use Transform<Dimension> to infer Dimension does not
@@ -1454,7 +1635,7 @@ public:
 		assert(time >= startTime); \
 		assert(time <= endTime); \
 		assert(time != initialTime()); \
-		events.emplace( \
+		events.emplace_back( \
 			id++, \
 			time, \
 			std::shared_ptr<EventBase>( \
@@ -1464,6 +1645,7 @@ public:
 				) \
 			) \
 		); \
+		sorted = false; \
 	} \
 	template <typename ...Ts> \
 	void add(Real time, const Transform##DIMENSION &transform, \
@@ -1471,7 +1653,7 @@ public:
 		assert(time >= startTime); \
 		assert(time <= endTime); \
 		assert(time != initialTime()); \
-		events.emplace( \
+		events.emplace_back( \
 			id++, \
 			time, \
 			std::shared_ptr<EventBase>( \
@@ -1481,6 +1663,7 @@ public:
 				) \
 			) \
 		); \
+		sorted = false; \
 	}
 
 	QUANT_PDE_TMP(1)
@@ -1495,22 +1678,22 @@ typedef TimeIteration<false> ReverseTimeIteration;
 typedef TimeIteration<true > ForwardTimeIteration;
 
 template <>
-Real ReverseTimeIteration::initialTime() const {
+inline Real ReverseTimeIteration::initialTime() const {
 	return endTime;
 }
 
 template <>
-Real ForwardTimeIteration::initialTime() const {
+inline Real ForwardTimeIteration::initialTime() const {
 	return startTime;
 }
 
 template <>
-Real ReverseTimeIteration::terminalTime() const {
+inline Real ReverseTimeIteration::terminalTime() const {
 	return startTime;
 }
 
 template <>
-Real ForwardTimeIteration::terminalTime() const {
+inline Real ForwardTimeIteration::terminalTime() const {
 	return endTime;
 }
 
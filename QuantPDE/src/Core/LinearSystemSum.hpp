@@ -1,18 +1,99 @@
 #ifndef QUANT_PDE_CORE_LINEAR_SYSTEM_SUM_HPP
 #define QUANT_PDE_CORE_LINEAR_SYSTEM_SUM_HPP
 
+#include <algorithm>    // std::equal, std::fill
 #include <forward_list> // std::forward_list
+#include <utility>      // std::move
+#include <vector>       // std::vector
 
 namespace QuantPDE {
 
+/**
+ * The sum of linear systems (e.g. a diffusion operator, a jump operator, and
+ * the coupling terms of a regime switching model).
+ *
+ * The matrix of each component and their sum are cached. A component is
+ * reassembled only if its matrix has changed (see
+ * QuantPDE::LinearSystem::isATheSame); if the sparsity pattern of the
+ * reassembled matrix is the same as before, the entries of the sum are updated
+ * in place instead of assembling the sum anew.
+ *
+ * The right-hand-side is not cached since it can depend on state other than
+ * the matrix (e.g. the iterand in a jump operator or the control in a
+ * controlled system).
+ */
 class LinearSystemSum : public LinearSystem {
 
 	std::forward_list<LinearSystem *> systems;
 
+	// Matrices of the components, their sum, and for each component, the
+	// position of each of its entries in the sum
+	std::vector<Matrix> parts;
+	std::vector<std::vector<Index>> positions;
+	Matrix sum;
+	bool assembled;
+
+	static bool isPatternTheSame(const Matrix &A, const Matrix &B) {
+		return A.rows() == B.rows() && A.cols() == B.cols()
+				&& A.nonZeros() == B.nonZeros()
+				&& std::equal(A.outerIndexPtr(), A.outerIndexPtr()
+				+ A.outerSize() + 1, B.outerIndexPtr())
+				&& std::equal(A.innerIndexPtr(), A.innerIndexPtr()
+				+ A.nonZeros(), B.innerIndexPtr());
+	}
+
+	// Assembles the sum and the positions of the entries of the parts
+	void assemble() {
+		sum = parts[0];
+		for(size_t k = 1; k < parts.size(); ++k) {
+			sum += parts[k];
+		}
+		sum.makeCompressed();
+
+		positions.resize(parts.size());
+		for(size_t k = 0; k < parts.size(); ++k) {
+			const Matrix &P = parts[k];
+			positions[k].resize(P.nonZeros());
+
+			// The columns of each row are sorted in both matrices
+			for(Index i = 0; i < P.outerSize(); ++i) {
+				Index s = sum.outerIndexPtr()[i];
+				for(Index p = P.outerIndexPtr()[i];
+						p < P.outerIndexPtr()[i + 1]; ++p) {
+					while(sum.innerIndexPtr()[s]
+							!= P.innerIndexPtr()[p]) {
+						++s;
+					}
+					positions[k][p] = s;
+				}
+			}
+		}
+	}
+
+	// Recomputes the entries of the sum (in the same order as assemble)
+	void update() {
+		Real *values = sum.valuePtr();
+		std::fill(values, values + sum.nonZeros(), 0.);
+		for(size_t k = 0; k < parts.size(); ++k) {
+			const Real *part = parts[k].valuePtr();
+			const Index *position = positions[k].data();
+			for(Index p = 0; p < parts[k].nonZeros(); ++p) {
+				values[position[p]] += part[p];
+			}
+		}
+	}
+
 public:
 
+	/**
+	 * Constructor.
+	 * @param args The linear systems to sum (at least one).
+	 */
 	template <typename ...Ts>
-	LinearSystemSum(Ts &...args) noexcept : systems( {(&args)...} ) {
+	LinearSystemSum(Ts &...args) noexcept : systems( {(&args)...} ),
+			assembled(false) {
+		static_assert(sizeof...(Ts) > 0, "At least one system is "
+				"required");
 	}
 
 	virtual bool isATheSame() const {
@@ -25,12 +106,34 @@ public:
 	}
 
 	virtual Matrix A(Real time) {
-		auto it = systems.begin();
-		Matrix A = (*it++)->A(time);
-		for(; it != systems.end(); ++it) {
-			A += (*it)->A(time);
+		bool changed = !assembled, samePattern = assembled;
+
+		size_t k = 0;
+		for(auto system : systems) {
+			if(!assembled) {
+				parts.push_back( system->A(time) );
+				parts.back().makeCompressed();
+			} else if(!system->isATheSame()) {
+				Matrix P = system->A(time);
+				P.makeCompressed();
+				samePattern = samePattern
+						&& isPatternTheSame(P, parts[k]);
+				parts[k] = std::move(P);
+				changed = true;
+			}
+			++k;
+		}
+
+		if(changed) {
+			if(samePattern) {
+				update();
+			} else {
+				assemble();
+			}
+			assembled = true;
 		}
-		return A;
+
+		return sum;
 	}
 
 	virtual Vector b(Real time) {
@@ -42,9 +145,22 @@ public:
 		return b;
 	}
 
+	virtual Vector Ax(Real time, const Vector &x) {
+		// The cached sum is valid at all times if no matrix changes
+		if(assembled && isATheSame()) {
+			return multiply(sum, x);
+		}
+
+		auto it = systems.begin();
+		Vector y = (*it++)->Ax(time, x);
+		for(; it != systems.end(); ++it) {
+			y += (*it)->Ax(time, x);
+		}
+		return y;
+	}
+
 };
 
 }
 
 #endif
-
@@ -323,7 +323,7 @@ class L2ProjectOnLagrangeBases1 final : public Map1 {
 	template <typename F1>
 	Vector map(F1 &&f) const {
 		Matrix M(G->size(), G->size());
-		M.reserve( IntegerVector::Constant(G->size(), 3) );
+		M.reserve( nonzerosPerRow(G->size(), 3) );
 
 		const Axis &S = (*G)[0];
 		const Index n = S.size();
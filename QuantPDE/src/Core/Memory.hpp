@@ -0,0 +1,131 @@
+#ifndef QUANT_PDE_CORE_MEMORY_HPP
+#define QUANT_PDE_CORE_MEMORY_HPP
+
+#include <algorithm> // std::max
+#include <cstdlib>   // size_t
+#include <utility>   // std::pair
+#include <vector>    // std::vector
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QUANT_PDE_GETRUSAGE
+#include <sys/resource.h> // getrusage
+#endif
+
+namespace QuantPDE {
+
+class IterationNode;
+
+/**
+ * @param v A vector.
+ * @return The number of bytes used to store the entries of the vector.
+ */
+inline size_t memoryUsage(const Vector &v) {
+	return v.size() * sizeof(Real);
+}
+
+/**
+ * @param A A sparse matrix.
+ * @return The number of bytes allocated to store the entries (and indices) of
+ *         the matrix.
+ */
+inline size_t memoryUsage(const Matrix &A) {
+	const size_t outer = A.outerSize() + 1
+			+ (A.isCompressed() ? 0 : A.outerSize());
+	return A.data().allocatedSize() * (sizeof(Real) + sizeof(Index))
+			+ outer * sizeof(Index);
+}
+
+/**
+ * @return The largest resident set size of this process thus far, in bytes
+ *         (zero if it is not available on this platform).
+ */
+inline size_t peakResidentMemory() {
+	#ifdef QUANT_PDE_GETRUSAGE
+	rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+
+	#ifdef __APPLE__
+	return usage.ru_maxrss;
+	#else
+	// Kilobytes on Linux
+	return usage.ru_maxrss * 1024;
+	#endif
+	#else
+	return 0;
+	#endif
+}
+
+/**
+ * The memory used by a solve, in bytes.
+ *
+ * The first three components are the memory held at the end of the solve; the
+ * peak is the largest of their sums sampled after each linear solve.
+ *
+ * @see QuantPDE::Iteration::memoryReport
+ */
+struct MemoryReport {
+
+	/**
+	 * Iterands (and times) kept by the iterative methods.
+	 */
+	size_t history;
+
+	/**
+	 * Vectors and matrices held by the iteration nodes (e.g. penalty
+	 * matrices or factored ADI components).
+	 */
+	size_t nodes;
+
+	/**
+	 * The bytes held by each iteration node (summing to nodes), in the
+	 * order the nodes were registered, outermost iterative method first.
+	 * The nodes are only identified by address, and so should only be
+	 * dereferenced while they are alive.
+	 */
+	std::vector<std::pair<const IterationNode *, size_t>> nodeUsage;
+
+	/**
+	 * The matrix and factors (or preconditioner) held by the linear
+	 * solver.
+	 */
+	size_t solver;
+
+	/**
+	 * The largest value of history + nodes + solver during the solve.
+	 */
+	size_t peak;
+
+	/**
+	 * The largest resident set size of the process at the end of the solve
+	 * (including everything outside of the solve).
+	 */
+	size_t peakResident;
+
+	/**
+	 * Constructor.
+	 */
+	MemoryReport() noexcept : history(0), nodes(0), solver(0), peak(0),
+			peakResident(0) {
+	}
+
+	/**
+	 * @return history + nodes + solver.
+	 */
+	size_t total() const {
+		return history + nodes + solver;
+	}
+
+	/**
+	 * Updates the peak to include the current total.
+	 */
+	void sample() {
+		peak = std::max(peak, total());
+	}
+
+};
+
+} // QuantPDE
+
+#endif
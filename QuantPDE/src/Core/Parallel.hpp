@@ -0,0 +1,672 @@
+#ifndef QUANT_PDE_CORE_PARALLEL_HPP
+#define QUANT_PDE_CORE_PARALLEL_HPP
+
+#include <algorithm>          // std::copy, std::lower_bound, std::max,
+                              // std::min
+#include <atomic>             // std::atomic
+#include <cassert>            // assert
+#include <condition_variable> // std::condition_variable
+#include <deque>              // std::deque
+#include <exception>          // std::current_exception, std::exception_ptr,
+                              // std::rethrow_exception
+#include <functional>         // std::function
+#include <memory>             // std::unique_ptr
+#include <mutex>              // std::lock_guard, std::mutex,
+                              // std::unique_lock
+#include <thread>             // std::thread, std::this_thread
+#include <utility>            // std::move
+#include <vector>             // std::vector
+
+namespace QuantPDE {
+
+/**
+ * A pool of threads that run tasks. Each thread has its own queue of tasks;
+ * it runs the most recently added task in its own queue, and when the queue is
+ * empty, it steals the oldest task from the queue of another thread (or of the
+ * threads outside of the pool). Threads that wait for a group of tasks to
+ * finish run tasks in the meantime, so that parallel loops may be nested
+ * without oversubscribing the processor or deadlocking.
+ *
+ * @see QuantPDE::ExecutionContext
+ */
+class ThreadPool {
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void ()>> tasks;
+	};
+
+	// The first queue is shared by the threads outside of the pool
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::atomic<Index> pending;
+	std::atomic<bool> done;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+
+	// The pool a thread belongs to and the index of its queue
+	static ThreadPool *&owner() {
+		static thread_local ThreadPool *pool = nullptr;
+		return pool;
+	}
+
+	static Index &index() {
+		static thread_local Index i = 0;
+		return i;
+	}
+
+	Index self() const {
+		return owner() == this ? index() : 0;
+	}
+
+	void push(Index k, std::function<void ()> task) {
+		Queue &queue = *queues[k];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back( std::move(task) );
+		}
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			++pending;
+		}
+	}
+
+	// Runs a task, if any; returns false otherwise
+	bool tryRun() {
+		const Index k = self(), n = queues.size();
+		std::function<void ()> task;
+
+		for(Index j = 0; j < n && !task; ++j) {
+			Queue &queue = *queues[(k + j) % n];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if(queue.tasks.empty()) {
+				continue;
+			}
+			if(j == 0) {
+				// Own queue (most recent)
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			} else {
+				// Steal (oldest)
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+		}
+
+		if(!task) {
+			return false;
+		}
+		--pending;
+		task();
+		return true;
+	}
+
+	void work(Index k) {
+		owner() = this;
+		index() = k;
+		while(!done) {
+			if(!tryRun()) {
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				wake.wait(lock, [&] { return pending > 0 || done; });
+			}
+		}
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param threads The number of threads that run tasks, including the
+	 *                threads outside of the pool that wait for tasks (so
+	 *                that the pool itself has one thread fewer).
+	 */
+	explicit ThreadPool(unsigned threads) : pending(0), done(false) {
+		assert(threads > 0);
+		for(unsigned k = 0; k < threads; ++k) {
+			queues.emplace_back(new Queue);
+		}
+		for(unsigned k = 1; k < threads; ++k) {
+			workers.emplace_back(&ThreadPool::work, this, k);
+		}
+	}
+
+	/**
+	 * Destructor. Waits for the threads to finish.
+	 */
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			done = true;
+		}
+		wake.notify_all();
+		for(auto &worker : workers) {
+			worker.join();
+		}
+	}
+
+	// Disable copy constructor and assignment operator.
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	/**
+	 * @return The number of threads that run tasks.
+	 */
+	unsigned size() const {
+		return queues.size();
+	}
+
+	/**
+	 * Calls task(k) for each k in [0, tasks) and waits for the calls to
+	 * finish. The calling thread runs the first task, and then other tasks
+	 * until all of the calls are finished.
+	 *
+	 * If the tasks are pinned (and there are no more tasks than threads),
+	 * the k-th task is queued for the k-th thread counting from the calling
+	 * thread, so that the same task runs on the same thread from one call
+	 * to the next (unless that thread is busy and the task is stolen).
+	 *
+	 * If calls throw, the remaining calls are still made and waited for;
+	 * the first exception caught is then rethrown on the calling thread.
+	 * @param tasks The number of tasks.
+	 * @param task The task.
+	 * @param pinned True if and only if the tasks are pinned.
+	 */
+	template <typename F>
+	void run(Index tasks, F &&task, bool pinned = false) {
+		if(tasks <= 0) {
+			return;
+		}
+
+		// Keep the first exception thrown by a call
+		std::exception_ptr error;
+		std::mutex errorMutex;
+		auto guarded = [&] (Index k) {
+			try {
+				task(k);
+			} catch(...) {
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if(!error) {
+					error = std::current_exception();
+				}
+			}
+		};
+
+		const Index k0 = self(), n = queues.size();
+		std::atomic<Index> remaining(tasks - 1);
+		for(Index k = 1; k < tasks; ++k) {
+			push( pinned ? (k0 + k) % n : k0,
+					[&guarded, &remaining, k] {
+				guarded(k);
+				--remaining;
+			} );
+		}
+		if(tasks > 1) {
+			if(pinned) {
+				// The right thread must pick up each task
+				wake.notify_all();
+			} else {
+				for(Index k = 1; k < tasks && k < n; ++k) {
+					wake.notify_one();
+				}
+			}
+		}
+
+		// The queued calls refer to this frame; wait for all of them
+		guarded(0);
+		while(remaining > 0) {
+			if(!tryRun()) {
+				std::this_thread::yield();
+			}
+		}
+
+		if(error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+};
+
+/**
+ * The resources (a thread pool) used by parallel loops. There is a global
+ * context; an Iteration (and the loops nested in it) may use another one
+ * instead, for example to limit the number of cores used by each of several
+ * pricings running concurrently:
+ * \code{.cpp}
+ * ExecutionContext context(4); // Four threads
+ * stepper.setExecutionContext(context);
+ * auto V = stepper.solve(grid, payoff, discretization, solver);
+ * \endcode
+ *
+ * @see QuantPDE::parallelFor
+ * @see QuantPDE::parallelReduce
+ */
+class ExecutionContext {
+
+	const unsigned count;
+	ThreadPool pool_;
+
+	static ExecutionContext *&scoped() {
+		static thread_local ExecutionContext *context = nullptr;
+		return context;
+	}
+
+	static std::unique_ptr<ExecutionContext> &globalPointer() {
+		static std::unique_ptr<ExecutionContext> context(
+				new ExecutionContext);
+		return context;
+	}
+
+	static unsigned hardware() {
+		const unsigned hardware = std::thread::hardware_concurrency();
+		return hardware > 0 ? hardware : 1;
+	}
+
+public:
+
+	/**
+	 * Makes a context the current context of the calling thread for the
+	 * lifetime of this object.
+	 */
+	class Scope {
+
+		ExecutionContext *previous;
+
+	public:
+
+		/**
+		 * Constructor.
+		 * @param context The context (or null for no change).
+		 */
+		explicit Scope(ExecutionContext *context) noexcept
+				: previous(scoped()) {
+			if(context) {
+				scoped() = context;
+			}
+		}
+
+		/**
+		 * Destructor. Restores the previous context.
+		 */
+		~Scope() {
+			scoped() = previous;
+		}
+
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+
+	};
+
+	/**
+	 * Constructor.
+	 * @param threads The number of threads (zero means use as many as
+	 *                there are hardware threads).
+	 */
+	explicit ExecutionContext(unsigned threads = 0)
+			: count(threads > 0 ? threads : hardware()),
+			pool_(count) {
+	}
+
+	// Disable copy constructor and assignment operator.
+	ExecutionContext(const ExecutionContext &) = delete;
+	ExecutionContext &operator=(const ExecutionContext &) = delete;
+
+	/**
+	 * @return The number of threads.
+	 */
+	unsigned threads() const {
+		return count;
+	}
+
+	/**
+	 * @return The thread pool.
+	 */
+	ThreadPool &pool() {
+		return pool_;
+	}
+
+	/**
+	 * @return The global context.
+	 */
+	static ExecutionContext &global() {
+		return *globalPointer();
+	}
+
+	/**
+	 * Replaces the global context. This should not be called while
+	 * parallel loops are running.
+	 * @param threads The number of threads (zero means use as many as
+	 *                there are hardware threads).
+	 */
+	static void setGlobal(unsigned threads) {
+		globalPointer().reset( new ExecutionContext(threads) );
+	}
+
+	/**
+	 * @return The context of the calling thread (that of the innermost
+	 *         scope, or the global context).
+	 */
+	static ExecutionContext &current() {
+		ExecutionContext *context = scoped();
+		return context ? *context : global();
+	}
+
+};
+
+/**
+ * Sets the number of threads of the global execution context.
+ * @param count The number of threads (zero means use as many as there are
+ *              hardware threads).
+ * @see QuantPDE::ExecutionContext::setGlobal
+ */
+inline void setThreads(unsigned count) {
+	ExecutionContext::setGlobal(count);
+}
+
+/**
+ * @return The number of threads of the current execution context.
+ */
+inline unsigned threads() {
+	return ExecutionContext::current().threads();
+}
+
+/**
+ * Calls body(i) for each i in [begin, end) using the threads of the current
+ * execution context. The range is split into contiguous blocks (a few per
+ * thread) that are balanced by work stealing. Since body(i) is called exactly
+ * once for each i, the result does not depend on the number of threads as long
+ * as the calls write to different locations. If the body throws, the first
+ * exception is rethrown once all of the blocks are finished.
+ * @param begin The first index.
+ * @param end One past the last index.
+ * @param body The loop body.
+ */
+template <typename F>
+void parallelFor(Index begin, Index end, F &&body) {
+	if(end <= begin) {
+		return;
+	}
+
+	ExecutionContext &context = ExecutionContext::current();
+	const Index n = end - begin;
+	const Index count = std::min<Index>(
+			context.threads() > 1 ? 4 * context.threads() : 1, n);
+
+	context.pool().run(count, [&] (Index k) {
+		// Loops nested in the body use the same context
+		ExecutionContext::Scope scope(&context);
+
+		const Index first = begin + (n * k) / count;
+		const Index last  = begin + (n * (k + 1)) / count;
+		for(Index i = first; i < last; ++i) {
+			body(i);
+		}
+	});
+}
+
+/**
+ * Calls body(k) for each k in [0, blocks) using the threads of the current
+ * execution context, with the k-th call pinned to the k-th thread (counting
+ * from the calling thread). Loops that split the same data into the same
+ * blocks then access each block from the same thread, e.g. the thread that
+ * first touched (and hence placed) its pages; see QuantPDE::setFirstTouch.
+ * If the body throws, the first exception is rethrown once all of the calls
+ * are finished.
+ * @param blocks The number of blocks (at most the number of threads).
+ * @param body The loop body.
+ */
+template <typename F>
+void parallelBlocks(Index blocks, F &&body) {
+	ExecutionContext &context = ExecutionContext::current();
+	assert(blocks <= (Index) context.threads());
+
+	context.pool().run(blocks, [&] (Index k) {
+		ExecutionContext::Scope scope(&context);
+		body(k);
+	}, true);
+}
+
+/**
+ * Reduces map(begin), ..., map(end - 1) using the threads of the current
+ * execution context. The range is split into contiguous blocks whose number
+ * depends only on the size of the range, each block is reduced from left to
+ * right, and the results of the blocks are reduced from left to right. The
+ * order of the operations, and hence the (floating point) result, does not
+ * depend on the number of threads.
+ * @param begin The first index.
+ * @param end One past the last index.
+ * @param identity The identity of the reduction.
+ * @param map Maps an index to a value.
+ * @param reduce Reduces two values (associative).
+ * @return The reduction.
+ */
+template <typename T, typename F, typename R>
+T parallelReduce(Index begin, Index end, T identity, F &&map, R &&reduce) {
+	if(end <= begin) {
+		return identity;
+	}
+
+	const Index n = end - begin;
+	const Index count = std::min<Index>(64, n);
+
+	std::vector<T> partial(count, identity);
+	parallelFor(0, count, [&] (Index k) {
+		const Index first = begin + (n * k) / count;
+		const Index last  = begin + (n * (k + 1)) / count;
+		T value = map(first);
+		for(Index i = first + 1; i < last; ++i) {
+			value = reduce(value, map(i));
+		}
+		partial[k] = value;
+	});
+
+	T result = identity;
+	for(Index k = 0; k < count; ++k) {
+		result = reduce(result, partial[k]);
+	}
+	return result;
+}
+
+/**
+ * @return A reference to the smallest number of nonzeros handled by each
+ *         thread in a (parallel) sparse matrix-vector product.
+ */
+inline Index &parallelMultiplyGrain() {
+	static Index grain = 16384;
+	return grain;
+}
+
+/**
+ * Sets the smallest number of nonzeros handled by each thread in a (parallel)
+ * sparse matrix-vector product. Products of matrices with fewer nonzeros than
+ * this are computed by the calling thread alone.
+ * @param grain The number of nonzeros.
+ */
+inline void setMultiplyGrain(Index grain) {
+	assert(grain > 0);
+	parallelMultiplyGrain() = grain;
+}
+
+/**
+ * @return A reference to true if and only if large vectors and matrices are
+ *         first touched in parallel.
+ */
+inline bool &parallelFirstTouch() {
+	static bool enabled = true;
+	return enabled;
+}
+
+/**
+ * Enables or disables parallel first touch. On NUMA systems, the operating
+ * system places each page of memory on the node of the thread that first
+ * writes to it. When enabled, the vectors created by domains (e.g.
+ * QuantPDE::DomainBase::zero) and the matrices given to iterative solvers are
+ * written for the first time by the threads that later process them in
+ * matrix-vector products, i.e. in the same blocks and on the same (pinned)
+ * threads, so that these products read mostly from local memory.
+ * @param enable True if and only if first touch is enabled.
+ * @see QuantPDE::parallelBlocks
+ */
+inline void setFirstTouch(bool enable) {
+	parallelFirstTouch() = enable;
+}
+
+/**
+ * @param nonZeros The number of nonzeros of a matrix (or the number of entries
+ *                 of a vector).
+ * @return The number of blocks into which matrix-vector products (and first
+ *         touches) split the rows.
+ */
+inline Index multiplyBlocks(Index nonZeros) {
+	return std::max<Index>( std::min<Index>( threads(),
+			nonZeros / parallelMultiplyGrain() ), 1 );
+}
+
+/**
+ * Sets all entries of a vector to a value. Large vectors are split evenly into
+ * contiguous blocks, as in matrix-vector products, each set by its own thread
+ * (if first touch is enabled).
+ * @param v The vector.
+ * @param value The value.
+ * @see QuantPDE::setFirstTouch
+ */
+inline void fill(Vector &v, Real value) {
+	const Index n = v.size();
+	const Index count = parallelFirstTouch() ? multiplyBlocks(n) : 1;
+	if(count == 1) {
+		v.setConstant(value);
+		return;
+	}
+
+	parallelBlocks(count, [&] (Index k) {
+		const Index first = (n * k) / count;
+		const Index last  = (n * (k + 1)) / count;
+		v.segment(first, last - first).setConstant(value);
+	});
+}
+
+// Rows at which the blocks of a (compressed) matrix begin; the blocks have
+// (roughly) the same number of nonzeros
+inline std::vector<Index> rowBlocks(const Matrix &A, Index count) {
+	const Index rows = A.rows();
+	const Index *outer = A.outerIndexPtr();
+	const Index nonZeros = outer[rows] - outer[0];
+
+	std::vector<Index> bounds(count + 1);
+	for(Index k = 0; k < count; ++k) {
+		bounds[k] = std::lower_bound(outer, outer + rows, outer[0]
+				+ (nonZeros * k) / count) - outer;
+	}
+	bounds[count] = rows;
+	return bounds;
+}
+
+/**
+ * Computes \f$y=Ax\f$ in parallel. The rows are split into contiguous blocks
+ * with (roughly) the same number of nonzeros, one per thread, and each block is
+ * pinned to its thread. Since each entry of the result is computed by one
+ * thread in the same order as a serial product, the result does not depend on
+ * the number of threads.
+ * @param A The matrix.
+ * @param x The vector (not aliased by the result).
+ * @param y The result.
+ * @see QuantPDE::setThreads
+ * @see QuantPDE::setMultiplyGrain
+ * @see QuantPDE::firstTouch
+ */
+inline void multiply(const Matrix &A, const Vector &x, Vector &y) {
+	assert(A.cols() == x.size());
+	assert(&x != &y);
+
+	const Index rows = A.rows();
+	y.resize(rows);
+
+	const Index *outer = A.outerIndexPtr();
+	const Index count = multiplyBlocks(outer[rows] - outer[0]);
+
+	// Null if the matrix is compressed
+	const Index *inner = A.innerNonZeroPtr();
+	const Index *columns = A.innerIndexPtr();
+	const Real *values = A.valuePtr();
+	const Real *xData = x.data();
+	Real *yData = y.data();
+
+	auto block = [&] (Index first, Index last) {
+		for(Index i = first; i < last; ++i) {
+			const Index end = inner ? outer[i] + inner[i]
+					: outer[i + 1];
+			Real sum = 0.;
+			for(Index k = outer[i]; k < end; ++k) {
+				sum += values[k] * xData[columns[k]];
+			}
+			yData[i] = sum;
+		}
+	};
+
+	if(count == 1) {
+		block(0, rows);
+		return;
+	}
+
+	const std::vector<Index> bounds = rowBlocks(A, count);
+	parallelBlocks(count, [&] (Index k) {
+		block(bounds[k], bounds[k + 1]);
+	});
+}
+
+/**
+ * Moves the entries of a matrix to memory first touched in parallel by the
+ * threads that process them in matrix-vector products, i.e. the rows are split
+ * into the same blocks as in QuantPDE::multiply and each block is copied by its
+ * own (pinned) thread. Does nothing if first touch is disabled or the matrix is
+ * too small to be multiplied in parallel.
+ * @param A The matrix (compressed on return).
+ * @see QuantPDE::setFirstTouch
+ */
+inline void firstTouch(Matrix &A) {
+	if(!parallelFirstTouch()) {
+		return;
+	}
+
+	A.makeCompressed();
+	const Index rows = A.rows(), nonZeros = A.nonZeros();
+	const Index count = multiplyBlocks(nonZeros);
+	if(count == 1) {
+		return;
+	}
+
+	// The arrays of nonzeros are allocated, but not written to
+	Matrix B(rows, A.cols());
+	B.resizeNonZeros(nonZeros);
+	std::copy(A.outerIndexPtr(), A.outerIndexPtr() + rows + 1,
+			B.outerIndexPtr());
+
+	const std::vector<Index> bounds = rowBlocks(A, count);
+	parallelBlocks(count, [&] (Index k) {
+		const Index first = A.outerIndexPtr()[bounds[k]];
+		const Index last = A.outerIndexPtr()[bounds[k + 1]];
+		std::copy(A.valuePtr() + first, A.valuePtr() + last,
+				B.valuePtr() + first);
+		std::copy(A.innerIndexPtr() + first, A.innerIndexPtr() + last,
+				B.innerIndexPtr() + first);
+	});
+
+	A.swap(B);
+}
+
+/**
+ * Computes \f$Ax\f$ in parallel.
+ * @param A The matrix.
+ * @param x The vector.
+ * @return The product.
+ * @see QuantPDE::multiply(const Matrix &, const Vector &, Vector &)
+ */
+inline Vector multiply(const Matrix &A, const Vector &x) {
+	Vector y;
+	multiply(A, x, y);
+	return y;
+}
+
+} // QuantPDE
+
+#endif
@@ -42,11 +42,11 @@ class PenaltyMethod : public IterationNode {
 		lb =  left->b( nextTime() );
 
 		// Evaluate the predicate using the previous iterand
-		Vector predicate = rA * iterand(0) - rb;
+		Vector predicate = multiply(rA, iterand(0)) - rb;
 
 		Vector compare = domain->zero();
 		if(direct) {
-			compare = lA * iterand(0) - lb;
+			compare = multiply(lA, iterand(0)) - lb;
 		}
 
 		// Initialize penalty matrix
@@ -110,8 +110,9 @@ public:
 
 		#ifdef QUANT_PDE_MODULES_HJBQVI_ITERATED_OPTIMAL_STOPPING
 		if(right_explicit) {
-			Matrix M = -(rA - domain->identity());
-			return Q * lb + P * (rb + M * iterand(0));
+			// (I - rA) x
+			const Vector Mx = iterand(0) - multiply(rA, iterand(0));
+			return Q * lb + P * (rb + Mx);
 		}
 		#endif
 
@@ -128,7 +129,7 @@ public:
 		std::vector<bool> mask;
 		mask.reserve(domain->size());
 
-		auto v = rA * iterand(0) - rb;
+		const Vector v = multiply(rA, iterand(0)) - rb;
 
 		for(Index i = 0; i < domain->size(); ++i) {
 			// Active constraint should be slightly negative
@@ -138,6 +139,15 @@ public:
 		return mask;
 	}
 
+	virtual size_t memoryUsage() const {
+		// Penalty matrices and the constraints of the last iteration
+		return QuantPDE::memoryUsage(P) + QuantPDE::memoryUsage(Q)
+				+ QuantPDE::memoryUsage(rA)
+				+ QuantPDE::memoryUsage(lA)
+				+ QuantPDE::memoryUsage(rb)
+				+ QuantPDE::memoryUsage(lb);
+	}
+
 };
 
 typedef PenaltyMethod<false> MinPenaltyMethod;
@@ -183,34 +193,12 @@ class PenaltyMethodDifference : public PenaltyMethod<Max> {
 			return function(time, array[Indices]...);
 		}
 
-		////////////////////////////////////////////////////////////////
-
-		template <Index N, typename T, typename ...Ts>
-		struct TimeWrapper : public TimeWrapper<N - 1, T, T, Ts...> {
-		};
-
-		template <typename T, typename ...Ts>
-		struct TimeWrapper<0, T, Ts...> {
-			static_assert(
-				sizeof...(Ts) == Dimension,
-				"The number of binding arguments in an event "
-				"should be equal to the dimension"
-			);
-
-			template <typename F1>
-			static inline Function<Dimension + 1> function(
-					F1 &&function) {
-				return [ QUANT_PDE_MOVE_CAPTURE(F1, function) ]
-						(Real t, Ts ...coordinates) {
-					return function(coordinates...);
-				};
-			}
-		};
-
-		////////////////////////////////////////////////////////////////
-
 		const Domain<Dimension> *domain;
+
+		// Time-independent functions are kept as they are, so that
+		// the domain can evaluate them in batches
 		F function;
+		Function<Dimension> spatial;
 
 	public:
 
@@ -220,8 +208,7 @@ class PenaltyMethodDifference : public PenaltyMethod<Max> {
 			const Function<Dimension> &function
 		) noexcept :
 			domain(&domain),
-			function( TimeWrapper<Dimension, Real>::function(
-					function) )
+			spatial(function)
 		{
 		}
 
@@ -231,8 +218,7 @@ class PenaltyMethodDifference : public PenaltyMethod<Max> {
 			Function<Dimension> &&function
 		) noexcept :
 			domain(&domain),
-			function( TimeWrapper<Dimension, Real>::function(
-					std::move(function)) )
+			spatial( std::move(function) )
 		{
 		}
 
@@ -261,6 +247,10 @@ class PenaltyMethodDifference : public PenaltyMethod<Max> {
 		}
 
 		virtual Vector b(Real t) {
+			if(spatial) {
+				return domain->image(spatial);
+			}
+
 			Vector v = domain->vector();
 			for(auto node : accessor(*domain, v)) {
 				*node = packAndCall(
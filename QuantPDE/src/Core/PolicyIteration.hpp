@@ -85,10 +85,10 @@ class PolicyIteration : public IterationNode {
 					inputs);
 
 			Vector bCandidate = system->b( nextTime() );
-			Matrix ACandidate = system->A( nextTime() );
 
 			// Compute A(q)x - b(q)
-			Vector candidate = ACandidate * iterand(0) - bCandidate;
+			Vector candidate = system->Ax( nextTime(), iterand(0) )
+					- bCandidate;
 
 			for(Index i = 0; i < domain->size(); ++i) {
 				if( Order()(candidate(i), best(i)) ) {
@@ -123,6 +123,14 @@ public:
 		return system->b(t);
 	}
 
+	virtual size_t memoryUsage() const {
+		// Vectors used to pick the optimal controls (the optimal and
+		// candidate controls, the best and candidate values, and the
+		// candidate right-hand side and product)
+		return (2 * ControlDimension + 4) * domain->size()
+				* sizeof(Real);
+	}
+
 	// TODO: Explicit discretizations
 
 };
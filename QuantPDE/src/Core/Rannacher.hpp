@@ -64,12 +64,10 @@ class Rannacher : public IterationNode {
 		const Vector &v0 = this->iterand(0);
 
 		// Make sure this gets called first
-		auto A = op.A(t0);
+		const Vector Av0 = op.Ax(t0, v0);
 
-		return (
-			this->domain.identity()
-			- A * h0 / 2.
-		) * v0 + ( op.b(t1) + op.b(t0) ) / 2.;
+		return v0 - Av0 * (h0 / 2.)
+				+ ( op.b(t1) + op.b(t0) ) / 2.;
 	}
 
 	void _onIterationEnd1() {
@@ -0,0 +1,372 @@
+#ifndef QUANT_PDE_CORE_REGIME_SWITCHING_HPP
+#define QUANT_PDE_CORE_REGIME_SWITCHING_HPP
+
+#include <algorithm>   // std::lower_bound
+#include <cassert>     // assert
+#include <cmath>       // std::abs
+#include <limits>      // std::numeric_limits
+#include <type_traits> // std::false_type, std::integral_constant,
+                       // std::true_type
+#include <vector>      // std::vector
+
+namespace QuantPDE {
+
+/**
+ * Couples the linear systems of several regimes by the generator
+ * \f$Q = \left(q_{kl}\right)\f$ of a continuous-time Markov chain. The
+ * \f$k\f$-th regime is driven by
+ * \f[
+ * 	V^k_t - \mathcal{L}^k V^k
+ * 	+ \sum_{l \neq k} q_{kl} \left( V^l - V^k \right) = 0.
+ * \f]
+ *
+ * The unknowns of the regimes are stacked (those of the first regime first).
+ * This is the ordering of the nodes of a grid with one more axis than the
+ * grid of the regimes, whose ticks are the regimes:
+ * \code{.cpp}
+ * RectilinearGrid1 G( Axis::uniform(0., 200., 101) );
+ * RectilinearGrid2 H(
+ * 	Axis::uniform(0., 200., 101), // Asset
+ * 	Axis::range(0., 1., 1.)       // Regime
+ * );
+ *
+ * BlackScholes1 calm(G, .05, .1, 0.), crisis(G, .05, .4, 0.);
+ * RegimeSwitching system({ {-.5, .5}, {1., -1.} }, calm, crisis);
+ *
+ * ReverseRannacher discretization(H, system);
+ * discretization.setIteration(stepper);
+ * BlockGaussSeidelSolver solver(2);
+ * auto V = stepper.solve(H, payoff, discretization, solver);
+ * V(100., 1.); // Price in the second regime
+ * \endcode
+ *
+ * @see QuantPDE::BlockRelaxationSolver
+ */
+class RegimeSwitching : public LinearSystem {
+
+	std::vector<LinearSystem *> regimes;
+	std::vector<std::vector<Real>> Q;
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param generator The generator of the Markov chain (nonnegative
+	 *                  off-diagonal entries and rows summing to zero).
+	 * @param args The linear systems of the regimes.
+	 */
+	template <typename ...Ts>
+	RegimeSwitching(const std::vector<std::vector<Real>> &generator,
+			Ts &...args) noexcept : regimes( {(&args)...} ),
+			Q(generator) {
+		assert(Q.size() == regimes.size());
+		#ifndef NDEBUG
+		for(size_t k = 0; k < Q.size(); ++k) {
+			assert(Q[k].size() == regimes.size());
+			Real sum = 0.;
+			for(size_t l = 0; l < Q.size(); ++l) {
+				assert(k == l || Q[k][l] >= 0.);
+				sum += Q[k][l];
+			}
+			assert(std::abs(sum) <= 1e3 * epsilon);
+		}
+		#endif
+	}
+
+	/**
+	 * @return The number of regimes.
+	 */
+	Index size() const {
+		return regimes.size();
+	}
+
+	virtual bool isATheSame() const {
+		for(auto system : regimes) {
+			if(!system->isATheSame()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @return The generator of the Markov chain.
+	 */
+	const std::vector<std::vector<Real>> &generator() const {
+		return Q;
+	}
+
+	/**
+	 * @param time The time.
+	 * @param k The index of a regime.
+	 * @return The k-th diagonal block of the left-hand-side matrix (i.e.,
+	 *         the matrix of the k-th regime with \f$-q_{kk}\f$ added to
+	 *         its diagonal). The l-th off-diagonal block of its row is
+	 *         \f$-q_{kl} I\f$.
+	 */
+	Matrix block(Real time, Index k) {
+		const Matrix B = regimes[k]->A(time);
+		Matrix I(B.rows(), B.cols());
+		I.setIdentity();
+
+		Matrix M = B - Q[k][k] * I;
+		M.makeCompressed();
+		return M;
+	}
+
+	virtual Matrix A(Real time) {
+		const Index K = regimes.size();
+
+		std::vector<Matrix> blocks;
+		blocks.reserve(K);
+		for(Index k = 0; k < K; ++k) {
+			blocks.push_back( block(time, k) );
+		}
+
+		const Index n = blocks[0].rows();
+
+		// Number of off-diagonal blocks in each row of blocks
+		std::vector<Index> couplings(K, 0);
+		size_t nonZeros = 0;
+		for(Index k = 0; k < K; ++k) {
+			assert(blocks[k].rows() == n);
+			for(Index l = 0; l < K; ++l) {
+				if(l != k && Q[k][l] != 0.) {
+					++couplings[k];
+				}
+			}
+			nonZeros += blocks[k].nonZeros()
+					+ (size_t) couplings[k] * n;
+		}
+
+		// Make sure the number of nonzeros is representable (see
+		// QUANT_PDE_64BIT_INDEX)
+		if(nonZeros > (size_t) std::numeric_limits<Index>::max()) {
+			throw "error: the number of nonzeros does not fit in "
+					"the index type";
+		}
+
+		Matrix M(K * n, K * n);
+		M.resizeNonZeros(nonZeros);
+		Index *outer = M.outerIndexPtr();
+		outer[0] = 0;
+		for(Index k = 0; k < K; ++k) {
+			const Index *b = blocks[k].outerIndexPtr();
+			for(Index i = 0; i < n; ++i) {
+				outer[k * n + i + 1] = outer[k * n + i]
+						+ couplings[k]
+						+ b[i + 1] - b[i];
+			}
+		}
+
+		// Each row holds the couplings to the regimes before its own,
+		// its row of the diagonal block and the couplings to the
+		// regimes after its own (so that the columns are sorted); the
+		// rows are filled in parallel
+		Index *inner = M.innerIndexPtr();
+		Real *values = M.valuePtr();
+		parallelFor(0, K * n, [&] (Index row) {
+			const Index k = row / n, i = row % n;
+			const Matrix &B = blocks[k];
+
+			Index p = outer[row];
+			for(Index l = 0; l < K; ++l) {
+				if(l == k) {
+					const Index *b = B.outerIndexPtr();
+					for(Index q = b[i]; q < b[i + 1]; ++q) {
+						inner[p] = k * n
+							+ B.innerIndexPtr()[q];
+						values[p++] = B.valuePtr()[q];
+					}
+				} else if(Q[k][l] != 0.) {
+					inner[p] = l * n + i;
+					values[p++] = -Q[k][l];
+				}
+			}
+		});
+
+		return M;
+	}
+
+	virtual Vector b(Real time) {
+		const Index K = regimes.size();
+
+		std::vector<Vector> blocks;
+		blocks.reserve(K);
+		for(auto system : regimes) {
+			blocks.push_back( system->b(time) );
+		}
+
+		const Index n = blocks[0].size();
+		Vector b(K * n);
+		for(Index k = 0; k < K; ++k) {
+			b.segment(k * n, n) = blocks[k];
+		}
+		return b;
+	}
+
+};
+
+/**
+ * Solves \f$Ax=b\f$ for matrices whose diagonal blocks (of equal size) are
+ * cheap to factor and whose off-diagonal blocks are weak, such as those of
+ * RegimeSwitching.
+ *
+ * The diagonal and off-diagonal blocks are cut out of the (row-major) matrix
+ * directly, and the diagonal blocks are factored once per call to initialize
+ * (in parallel).
+ * Each sweep solves for each block with the off-diagonal blocks lagged, either
+ * using the most recent values of the other blocks (Gauss-Seidel) or those of
+ * the previous sweep (Jacobi, in which case the blocks are solved in
+ * parallel). Sweeps stop once the relative change in the solution falls below
+ * a tolerance. The factorizations use the natural ordering, so that blocks
+ * that are banded (e.g. tridiagonal, for one-dimensional regimes) are factored
+ * without fill-in.
+ *
+ * @tparam Jacobi True for block Jacobi, false for block Gauss-Seidel.
+ */
+template <bool Jacobi>
+class BlockRelaxationSolver : public LinearSolver {
+
+	const Index K;
+	const Real tolerance;
+	const int maxIterations;
+
+	Index n;
+	std::vector<SparseLU> factorizations;
+	Matrix offDiagonal;
+
+	virtual void initialize() {
+		assert(A.rows() == A.cols());
+		assert(A.rows() % K == 0);
+		n = A.rows() / K;
+		const Index N = A.rows();
+
+		A.makeCompressed();
+		const Index *outer = A.outerIndexPtr();
+		const Index *inner = A.innerIndexPtr();
+		const Real *values = A.valuePtr();
+
+		// The columns of each row are sorted, so that the entries of a
+		// row in its diagonal block are those in [first[i], last[i])
+		std::vector<Index> first(N), last(N);
+		parallelFor(0, N, [&] (Index i) {
+			const Index k = i / n;
+			first[i] = std::lower_bound(inner + outer[i],
+					inner + outer[i + 1], k * n) - inner;
+			last[i] = std::lower_bound(inner + first[i],
+					inner + outer[i + 1], (k + 1) * n)
+					- inner;
+		});
+
+		// Off-diagonal blocks (the remaining entries of each row)
+		offDiagonal = Matrix(N, N);
+		Index *offOuter = offDiagonal.outerIndexPtr();
+		offOuter[0] = 0;
+		for(Index i = 0; i < N; ++i) {
+			offOuter[i + 1] = offOuter[i]
+					+ (outer[i + 1] - outer[i])
+					- (last[i] - first[i]);
+		}
+		offDiagonal.resizeNonZeros(offOuter[N]);
+		parallelFor(0, N, [&] (Index i) {
+			Index *offInner = offDiagonal.innerIndexPtr();
+			Real *offValues = offDiagonal.valuePtr();
+
+			Index p = offOuter[i];
+			for(Index q = outer[i]; q < first[i]; ++q) {
+				offInner[p] = inner[q];
+				offValues[p++] = values[q];
+			}
+			for(Index q = last[i]; q < outer[i + 1]; ++q) {
+				offInner[p] = inner[q];
+				offValues[p++] = values[q];
+			}
+		});
+
+		// Diagonal blocks, cut out of the rows and factored in parallel
+		factorizations = std::vector<SparseLU>(K);
+		parallelFor(0, K, [&] (Index k) {
+			Matrix B(n, n);
+			Index *b = B.outerIndexPtr();
+			b[0] = 0;
+			for(Index i = 0; i < n; ++i) {
+				const Index row = k * n + i;
+				b[i + 1] = b[i] + last[row] - first[row];
+			}
+			B.resizeNonZeros(b[n]);
+			for(Index i = 0; i < n; ++i) {
+				const Index row = k * n + i;
+				Index p = b[i];
+				for(Index q = first[row]; q < last[row]; ++q) {
+					B.innerIndexPtr()[p] = inner[q] - k * n;
+					B.valuePtr()[p++] = values[q];
+				}
+			}
+
+			factorizations[k].analyzePattern(B);
+			factorizations[k].factorize(B);
+			assert(factorizations[k].info() == Eigen::Success);
+		});
+	}
+
+	// One sweep of block Jacobi
+	void sweep(const Vector &b, const Vector &previous, Vector &x,
+			std::true_type) {
+		const Vector rhs = b - multiply(offDiagonal, previous);
+		parallelFor(0, K, [&] (Index k) {
+			x.segment(k * n, n) = factorizations[k].solve(
+					rhs.segment(k * n, n));
+		});
+	}
+
+	// One sweep of block Gauss-Seidel
+	void sweep(const Vector &b, const Vector &, Vector &x,
+			std::false_type) {
+		for(Index k = 0; k < K; ++k) {
+			const Vector rhs = b.segment(k * n, n)
+					- offDiagonal.middleRows(k * n, n) * x;
+			x.segment(k * n, n) = factorizations[k].solve(rhs);
+		}
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param blocks The number of diagonal blocks.
+	 * @param tolerance The relative change in the solution below which
+	 *                  sweeps stop.
+	 * @param maxIterations The maximum number of sweeps.
+	 */
+	BlockRelaxationSolver(Index blocks, Real tolerance = 1e-10,
+			int maxIterations = 1000) noexcept : LinearSolver(),
+			K(blocks), tolerance(tolerance),
+			maxIterations(maxIterations), n(0) {
+		assert(blocks > 0);
+	}
+
+	virtual Vector solve(const Vector &b, const Vector &guess) {
+		Vector x = guess, previous;
+
+		int iterations = 0;
+		do {
+			previous = x;
+			sweep(b, previous, x, std::integral_constant<bool,
+					Jacobi>());
+			++iterations;
+		} while(relativeError(x, previous) > tolerance
+				&& iterations < maxIterations);
+
+		its.push_back(iterations);
+		return x;
+	}
+
+};
+
+typedef BlockRelaxationSolver<false> BlockGaussSeidelSolver;
+typedef BlockRelaxationSolver<true>  BlockJacobiSolver;
+
+} // QuantPDE
+
+#endif
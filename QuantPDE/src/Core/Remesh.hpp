@@ -0,0 +1,416 @@
+#ifndef QUANT_PDE_CORE_REMESH_HPP
+#define QUANT_PDE_CORE_REMESH_HPP
+
+#include <algorithm> // std::max, std::max_element, std::sort,
+                     // std::upper_bound
+#include <array>     // std::array
+#include <cassert>   // assert
+#include <cmath>     // std::abs, std::floor, std::sqrt
+#include <memory>    // std::unique_ptr
+#include <utility>   // std::forward, std::move
+#include <vector>    // std::vector
+
+namespace QuantPDE {
+
+/**
+ * Estimates the magnitude of the second derivative of a function along an axis
+ * of a grid.
+ * @param grid The grid.
+ * @param vector The values of the function on the grid nodes.
+ * @param d The axis.
+ * @return For each tick on the d-th axis, the maximum (over all grid lines
+ *         parallel to the axis) absolute second divided difference. Values at
+ *         the first and last ticks are copied from their neighbours.
+ */
+template <Index Dimension>
+std::vector<Real> curvatureIndicator(
+	const RectilinearGrid<Dimension> &grid,
+	const Vector &vector,
+	Index d
+) {
+	const Axis &x = grid[d];
+	const Index n = x.size();
+
+	std::vector<Real> indicator(n, 0.);
+	if(n < 3) {
+		return indicator;
+	}
+
+	// Space between ticks on the d-th axis
+	Index offset = 1;
+	for(Index e = 0; e < d; ++e) {
+		offset *= grid[e].size();
+	}
+
+	for(Index idx = 0; idx < grid.size(); ++idx) {
+		const Index i = (idx / offset) % n;
+		if(i == 0 || i == n - 1) {
+			continue;
+		}
+
+		const Real
+			dxb = x[i]     - x[i - 1],
+			dxf = x[i + 1] - x[i]
+		;
+
+		const Real second = 2. * (
+			(vector(idx + offset) - vector(idx)) / dxf
+			- (vector(idx) - vector(idx - offset)) / dxb
+		) / (dxb + dxf);
+
+		indicator[i] = std::max(indicator[i], std::abs(second));
+	}
+
+	indicator[0] = indicator[1];
+	indicator[n - 1] = indicator[n - 2];
+
+	return indicator;
+}
+
+/**
+ * Places ticks so that each interval carries the same mass of a monitor
+ * function (de Boor's equidistribution principle). Fixed ticks (and the
+ * endpoints of the axis) are always kept; each interval between two consecutive
+ * fixed ticks receives a number of new intervals proportional to its mass (and
+ * at least one).
+ * @param axis The axis.
+ * @param monitor A positive value for each tick on the axis; the monitor
+ *                function is taken to be piecewise constant, equal to the
+ *                average of its values at the endpoints of each interval.
+ * @param points The number of ticks on the new axis.
+ * @param fixed Ticks to keep (ticks outside of the axis are ignored).
+ * @return The new axis.
+ */
+inline Axis equidistribute(
+	const Axis &axis,
+	const std::vector<Real> &monitor,
+	Index points,
+	std::vector<Real> fixed = std::vector<Real>()
+) {
+	const Index n = axis.size();
+	assert((Index) monitor.size() == n);
+	assert(n > 1);
+
+	const Real a = axis[0], b = axis[n - 1];
+
+	// Cumulative mass at each tick
+	std::vector<Real> mass(n, 0.);
+	for(Index i = 1; i < n; ++i) {
+		assert(monitor[i] > 0.);
+		mass[i] = mass[i - 1] + (axis[i] - axis[i - 1])
+				* (monitor[i - 1] + monitor[i]) / 2.;
+	}
+
+	// Inverse of the cumulative mass (piecewise linear)
+	auto position = [&] (Real m) {
+		Index i = std::upper_bound(mass.begin(), mass.end(), m)
+				- mass.begin();
+		if(i >= n) {
+			return b;
+		}
+		if(i < 1) {
+			return a;
+		}
+		return axis[i - 1] + (axis[i] - axis[i - 1])
+				* (m - mass[i - 1]) / (mass[i] - mass[i - 1]);
+	};
+
+	// Mass at an arbitrary point
+	auto cumulative = [&] (Real y) {
+		const Real *x = axis.ticks();
+		Index i = std::upper_bound(x, x + n, y) - x;
+		if(i >= n) {
+			return mass[n - 1];
+		}
+		return mass[i - 1] + (y - axis[i - 1]) / (axis[i]
+				- axis[i - 1]) * (mass[i] - mass[i - 1]);
+	};
+
+	// Segments between fixed ticks
+	std::vector<Real> breaks { a };
+	std::sort(fixed.begin(), fixed.end());
+	for(Real y : fixed) {
+		if(y > breaks.back() && y < b) {
+			breaks.push_back(y);
+		}
+	}
+	breaks.push_back(b);
+
+	const Index segments = breaks.size() - 1;
+	const Index intervals = std::max<Index>(points - 1, segments);
+
+	// Distribute intervals (at least one per segment) by the largest
+	// remainder
+	std::vector<Real> masses(segments);
+	for(Index s = 0; s < segments; ++s) {
+		masses[s] = cumulative(breaks[s + 1]) - cumulative(breaks[s]);
+	}
+
+	std::vector<Index> counts(segments, 1);
+	Index remaining = intervals - segments;
+	std::vector<Real> share(segments);
+	Index assigned = 0;
+	for(Index s = 0; s < segments; ++s) {
+		share[s] = remaining * masses[s] / mass[n - 1];
+		const Index whole = std::floor(share[s]);
+		counts[s] += whole;
+		share[s] -= whole;
+		assigned += whole;
+	}
+	while(assigned < remaining) {
+		const Index s = std::max_element(share.begin(), share.end())
+				- share.begin();
+		++counts[s];
+		share[s] = -1.;
+		++assigned;
+	}
+
+	// Place ticks
+	std::vector<Real> ticks;
+	ticks.reserve(intervals + 1);
+	ticks.push_back(a);
+	for(Index s = 0; s < segments; ++s) {
+		const Real m0 = cumulative(breaks[s]);
+		for(Index j = 1; j < counts[s]; ++j) {
+			const Real y = position(m0 + masses[s] * j / counts[s]);
+			if(y > ticks.back() && y < breaks[s + 1]) {
+				ticks.push_back(y);
+			}
+		}
+		ticks.push_back(breaks[s + 1]);
+	}
+
+	return Axis(ticks);
+}
+
+/**
+ * Moves the ticks of a rectilinear grid toward regions where a function has
+ * large curvature (and away from regions where it is close to linear).
+ *
+ * On each axis, the monitor function is
+ * \f$\sqrt{\left|u''\right| + \epsilon}\f$, where \f$u''\f$ is estimated by
+ * curvatureIndicator and \f$\epsilon\f$ is a fraction (the floor) of the
+ * average of \f$\left|u''\right|\f$; equidistributing the square root of the
+ * curvature is optimal for the error of piecewise linear interpolation. The
+ * monitor is smoothed to avoid abrupt changes in the spacing of ticks.
+ *
+ * @see QuantPDE::equidistribute
+ * @see QuantPDE::solveWithRemeshing
+ */
+template <Index Dimension>
+class Remesher {
+
+	Real floor;
+	int smoothing;
+	unsigned mask;
+
+	std::vector<Real> fixed[Dimension];
+	Index points[Dimension];
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param floor The floor of the monitor function relative to the
+	 *              average curvature; larger values keep the grid closer
+	 *              to uniform.
+	 * @param smoothing The number of smoothing passes applied to the
+	 *                  monitor function.
+	 * @param mask An unsigned integer whose k-th bit is 1 if and only if
+	 *             the k-th axis should be left unchanged.
+	 */
+	explicit Remesher(
+		Real floor = 0.05,
+		int smoothing = 2,
+		unsigned mask = 0
+	) noexcept :
+		floor(floor),
+		smoothing(smoothing),
+		mask(mask)
+	{
+		assert(floor > 0.);
+		assert(smoothing >= 0);
+
+		for(Index d = 0; d < Dimension; ++d) {
+			points[d] = -1;
+		}
+	}
+
+	/**
+	 * Keeps a tick (e.g. a strike or a barrier) on an axis.
+	 * @param d The axis.
+	 * @param tick The tick.
+	 */
+	void fix(Index d, Real tick) {
+		fixed[d].push_back(tick);
+	}
+
+	/**
+	 * Sets the number of ticks on an axis after remeshing (by default, the
+	 * number of ticks is unchanged).
+	 * @param d The axis.
+	 * @param n The number of ticks.
+	 */
+	void setPoints(Index d, Index n) {
+		assert(n > 1);
+		points[d] = n;
+	}
+
+	/**
+	 * @param grid The grid.
+	 * @param vector The values of a function on the grid nodes.
+	 * @return The remeshed grid.
+	 */
+	RectilinearGrid<Dimension> operator()(
+		const RectilinearGrid<Dimension> &grid,
+		const Vector &vector
+	) const {
+		std::vector<Axis> axes;
+		axes.reserve(Dimension);
+
+		for(Index d = 0; d < Dimension; ++d) {
+			const Axis &x = grid[d];
+			const Index n = x.size();
+
+			if((mask & (1 << d)) || n < 3) {
+				axes.push_back(x);
+				continue;
+			}
+
+			std::vector<Real> monitor = curvatureIndicator(grid,
+					vector, d);
+
+			Real average = 0.;
+			for(Index i = 1; i < n; ++i) {
+				average += (x[i] - x[i - 1])
+						* (monitor[i - 1] + monitor[i])
+						/ 2.;
+			}
+			average /= x[n - 1] - x[0];
+
+			const Real epsilon = average > 0. ? floor * average
+					: 1.;
+			for(Index i = 0; i < n; ++i) {
+				monitor[i] = std::sqrt(monitor[i] + epsilon);
+			}
+
+			for(int k = 0; k < smoothing; ++k) {
+				std::vector<Real> smoothed(monitor);
+				for(Index i = 1; i < n - 1; ++i) {
+					smoothed[i] = (monitor[i - 1]
+							+ 2. * monitor[i]
+							+ monitor[i + 1]) / 4.;
+				}
+				monitor = std::move(smoothed);
+			}
+
+			axes.push_back(equidistribute(x, monitor,
+					points[d] > 0 ? points[d] : n,
+					fixed[d]));
+		}
+
+		return RectilinearGrid<Dimension>(axes.data());
+	}
+
+};
+
+typedef Remesher<1> Remesher1;
+typedef Remesher<2> Remesher2;
+typedef Remesher<3> Remesher3;
+
+/**
+ * Solves a problem in segments (e.g. between event times or every few
+ * timesteps), remeshing the grid between segments. The solution at the end of a
+ * segment is interpolated onto the remeshed grid and used as the initial
+ * condition of the next segment. Before the first segment, the grid is
+ * remeshed using the initial condition.
+ *
+ * The example below solves backwards in time, remeshing every 0.1 years:
+ * \code{.cpp}
+ * Remesher1 remesher;
+ * remesher.fix(0, K);
+ *
+ * auto V = solveWithRemeshing(
+ * 	grid,
+ * 	{ T, 0.9 * T, ..., 0. },
+ * 	payoff,
+ * 	[&] (const RectilinearGrid1 &G, Real start, Real end,
+ * 			const InterpolantWrapper1 &V) {
+ * 		ReverseConstantStepper stepper(end, start, dt);
+ * 		BlackScholes1 bs(G, r, v, q);
+ * 		ReverseRannacher discretization(G, bs);
+ * 		discretization.setIteration(stepper);
+ * 		return stepper.solve(G, V, discretization, solver);
+ * 	},
+ * 	remesher
+ * );
+ * \endcode
+ * @param grid The initial grid.
+ * @param times The endpoints of the segments, in the order in which they are
+ *              solved.
+ * @param initialCondition The initial condition.
+ * @param solve Called with the grid, the start and end times of a segment and
+ *              the initial condition of the segment (as an
+ *              InterpolantWrapper);
+ *              returns the solution at the end of the segment (as an
+ *              interpolant).
+ * @param remesher Remeshes the grid.
+ * @return The solution.
+ */
+template <Index Dimension, typename F, typename S>
+InterpolantWrapper<Dimension> solveWithRemeshing(
+	const RectilinearGrid<Dimension> &grid,
+	const std::vector<Real> &times,
+	F &&initialCondition,
+	S &&solve,
+	const Remesher<Dimension> &remesher
+) {
+	assert(times.size() > 1);
+
+	// The initial condition as an interpolant
+	class Initial : public Interpolant<Dimension> {
+		const F &function;
+	public:
+		Initial(const F &function) noexcept : function(function) {
+		}
+		virtual Real interpolate(
+				const std::array<Real, Dimension> &coordinates)
+				const {
+			return packAndCall<Dimension>(function,
+					coordinates.data());
+		}
+		virtual std::unique_ptr<Interpolant<Dimension>> clone() const {
+			return std::unique_ptr<Interpolant<Dimension>>(
+					new Initial(function));
+		}
+	};
+
+	InterpolantWrapper<Dimension> V(
+		std::unique_ptr<Interpolant<Dimension>>(
+				new Initial(initialCondition))
+	);
+
+	std::unique_ptr<RectilinearGrid<Dimension>> G(
+		new RectilinearGrid<Dimension>(remesher(grid,
+				grid.image(initialCondition)))
+	);
+
+	for(size_t k = 0; k + 1 < times.size(); ++k) {
+		if(k > 0) {
+			// Remesh using the solution on the current grid
+			G = std::unique_ptr<RectilinearGrid<Dimension>>(
+				new RectilinearGrid<Dimension>(remesher(*G,
+						G->image(V)))
+			);
+		}
+
+		const InterpolantWrapper<Dimension> &initial = V;
+		V = solve(*G, times[k], times[k + 1], initial);
+	}
+
+	return V;
+}
+
+} // QuantPDE
+
+#endif
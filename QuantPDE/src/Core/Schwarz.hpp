@@ -0,0 +1,301 @@
+#ifndef QUANT_PDE_CORE_SCHWARZ_HPP
+#define QUANT_PDE_CORE_SCHWARZ_HPP
+
+#include <algorithm> // std::max, std::min
+#include <array>     // std::array
+#include <cassert>   // assert
+#include <memory>    // std::unique_ptr
+#include <vector>    // std::vector
+
+namespace QuantPDE {
+
+/**
+ * Solves \f$Ax=b\f$ with BiCGSTAB preconditioned by the restricted additive
+ * Schwarz method @cite cai1999restricted , where \f$A\f$ is a matrix whose
+ * rows and columns correspond to the nodes of a rectilinear grid.
+ *
+ * The grid is split into boxes, each containing a contiguous range of ticks
+ * along each axis, that are then extended by a number of ticks (the overlap)
+ * in each direction. The rows and columns of the matrix restricted to each of
+ * the extended boxes (subdomains) are factored independently, in parallel.
+ * Applying the preconditioner solves on each of the subdomains in parallel and
+ * keeps only the values at the nodes of the original (disjoint) boxes.
+ *
+ * Optionally, the residual left by the subdomain solves is corrected on a
+ * coarse space with one (constant) function per box. This curbs the growth of
+ * the number of iterations with the number of boxes when the matrix is far
+ * from diagonally dominant (e.g. for large timesteps).
+ *
+ * Since the factorizations are computed by initialize, they are reused across
+ * timesteps as long as the matrix does not change:
+ * \code{.cpp}
+ * RectilinearGrid2 grid(
+ * 	Axis::uniform(0., 400., 801),
+ * 	Axis::uniform(0., 400., 801)
+ * );
+ *
+ * // 4x4 boxes with an overlap of 4 ticks and a coarse correction
+ * SchwarzSolver2 solver(grid, {4, 4}, 4, true);
+ * auto V = stepper.solve(grid, payoff, discretization, solver);
+ * \endcode
+ */
+template <Index Dimension>
+class SchwarzSolver : public LinearSolver {
+
+	// Fill-reducing orderings need column-major storage
+	typedef Eigen::SparseMatrix<Real, Eigen::ColMajor, Index> ColumnMatrix;
+	typedef Eigen::SparseLU<ColumnMatrix, Eigen::COLAMDOrdering<Index>>
+			Factorization;
+
+	struct Subdomain {
+		// Extended box and the box itself (ticks, end exclusive)
+		std::array<Index, Dimension> first, last, ownedFirst, ownedLast;
+
+		// Nodes of the extended box (increasing)
+		std::vector<Index> nodes;
+
+		// For each node of the extended box, whether it is in the box
+		std::vector<bool> owned;
+
+		std::unique_ptr<Factorization> factorization;
+	};
+
+	std::array<Index, Dimension> sizes, strides, boxes;
+	const Index overlap;
+	const bool coarse;
+	const Real tolerance;
+	const int maxIterations;
+
+	std::vector<Subdomain> subdomains;
+
+	// The box containing each node and the coarse factorization
+	std::vector<Index> box;
+	Factorization coarseFactorization;
+
+	// Local index of a node in a subdomain (or -1 if it is not in there)
+	Index local(const Subdomain &s, Index node) const {
+		Index result = 0, stride = 1;
+		for(Index d = 0; d < Dimension; ++d) {
+			const Index i = (node / strides[d]) % sizes[d];
+			if(i < s.first[d] || i >= s.last[d]) {
+				return -1;
+			}
+			result += (i - s.first[d]) * stride;
+			stride *= s.last[d] - s.first[d];
+		}
+		return result;
+	}
+
+	virtual void initialize() {
+		assert(A.rows() == A.cols());
+		#ifndef NDEBUG
+		Index n = 1;
+		for(Index d = 0; d < Dimension; ++d) {
+			n *= sizes[d];
+		}
+		assert(A.rows() == n);
+		#endif
+
+		firstTouch(A);
+
+		parallelFor(0, subdomains.size(), [&] (Index k) {
+			Subdomain &s = subdomains[k];
+			const Index m = s.nodes.size();
+
+			std::vector<Entry> entries;
+			for(Index i = 0; i < m; ++i) {
+				for(Matrix::InnerIterator it(A, s.nodes[i]); it;
+						++it) {
+					const Index j = local(s, it.col());
+					if(j >= 0) {
+						entries.emplace_back(i, j,
+								it.value());
+					}
+				}
+			}
+
+			ColumnMatrix B(m, m);
+			B.setFromTriplets(entries.begin(), entries.end());
+			B.makeCompressed();
+
+			s.factorization.reset(new Factorization);
+			s.factorization->analyzePattern(B);
+			s.factorization->factorize(B);
+			assert(s.factorization->info() == Eigen::Success);
+		});
+
+		if(coarse) {
+			// Galerkin projection onto the piecewise constants
+			std::vector<Entry> entries;
+			for(Index i = 0; i < A.rows(); ++i) {
+				for(Matrix::InnerIterator it(A, i); it; ++it) {
+					entries.emplace_back(box[i],
+							box[it.col()],
+							it.value());
+				}
+			}
+
+			const Index K = subdomains.size();
+			ColumnMatrix A0(K, K);
+			A0.setFromTriplets(entries.begin(), entries.end());
+			A0.makeCompressed();
+
+			coarseFactorization.analyzePattern(A0);
+			coarseFactorization.factorize(A0);
+			assert(coarseFactorization.info() == Eigen::Success);
+		}
+	}
+
+	// Applies the preconditioner
+	Vector precondition(const Vector &r) {
+		Vector z(r.size());
+
+		// The boxes are disjoint, so that the subdomains write to
+		// different nodes
+		parallelFor(0, subdomains.size(), [&] (Index k) {
+			const Subdomain &s = subdomains[k];
+			const Index m = s.nodes.size();
+
+			Vector rk(m);
+			for(Index i = 0; i < m; ++i) {
+				rk(i) = r(s.nodes[i]);
+			}
+
+			const Vector zk = s.factorization->solve(rk);
+			for(Index i = 0; i < m; ++i) {
+				if(s.owned[i]) {
+					z(s.nodes[i]) = zk(i);
+				}
+			}
+		});
+
+		if(coarse) {
+			// Correct the remaining residual (multiplicatively)
+			const Vector residual = r - multiply(A, z);
+
+			Vector r0 = Vector::Zero(subdomains.size());
+			for(Index i = 0; i < r.size(); ++i) {
+				r0(box[i]) += residual(i);
+			}
+
+			const Vector z0 = coarseFactorization.solve(r0);
+			for(Index i = 0; i < r.size(); ++i) {
+				z(i) += z0(box[i]);
+			}
+		}
+
+		return z;
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param grid The grid.
+	 * @param boxes The number of boxes along each axis.
+	 * @param overlap The number of ticks by which the boxes are extended
+	 *                in each direction.
+	 * @param coarse True if and only if a coarse correction is added.
+	 * @param tolerance The relative residual below which iterations stop.
+	 * @param maxIterations The maximum number of iterations.
+	 */
+	SchwarzSolver(
+		const RectilinearGrid<Dimension> &grid,
+		const std::array<Index, Dimension> &boxes,
+		Index overlap = 2,
+		bool coarse = false,
+		Real tolerance = 1e-10,
+		int maxIterations = 1000
+	) : LinearSolver(), boxes(boxes), overlap(overlap), coarse(coarse),
+			tolerance(tolerance), maxIterations(maxIterations),
+			box(grid.size()) {
+		assert(overlap >= 0);
+
+		Index K = 1;
+		for(Index d = 0; d < Dimension; ++d) {
+			sizes[d] = grid[d].size();
+			strides[d] = d == 0 ? 1 : strides[d - 1] * sizes[d - 1];
+			assert(boxes[d] > 0 && boxes[d] <= sizes[d]);
+			K *= boxes[d];
+		}
+
+		subdomains.resize(K);
+		for(Index k = 0; k < K; ++k) {
+			Subdomain &s = subdomains[k];
+
+			// Ticks of the box and the extended box along each axis
+			Index c = k, m = 1;
+			for(Index d = 0; d < Dimension; ++d) {
+				const Index b = c % boxes[d];
+				c /= boxes[d];
+
+				s.ownedFirst[d] = (sizes[d] * b) / boxes[d];
+				s.ownedLast[d] = (sizes[d] * (b + 1)) / boxes[d];
+				s.first[d] = std::max<Index>(s.ownedFirst[d]
+						- overlap, 0);
+				s.last[d] = std::min<Index>(s.ownedLast[d]
+						+ overlap, sizes[d]);
+				m *= s.last[d] - s.first[d];
+			}
+
+			// Nodes of the extended box, in increasing order
+			s.nodes.reserve(m);
+			s.owned.reserve(m);
+			for(Index j = 0; j < m; ++j) {
+				Index node = 0, r = j;
+				bool owned = true;
+				for(Index d = 0; d < Dimension; ++d) {
+					const Index extent = s.last[d]
+							- s.first[d];
+					const Index i = s.first[d] + r % extent;
+					r /= extent;
+
+					node += i * strides[d];
+					owned = owned && i >= s.ownedFirst[d]
+							&& i < s.ownedLast[d];
+				}
+
+				s.nodes.push_back(node);
+				s.owned.push_back(owned);
+				if(owned) {
+					box[node] = k;
+				}
+			}
+		}
+	}
+
+	virtual Vector solve(const Vector &b, const Vector &guess) {
+		Vector x = guess;
+		its.push_back( bicgstab(A, b, x, [&] (const Vector &r) {
+			return precondition(r);
+		}, tolerance, maxIterations) );
+		return x;
+	}
+
+	virtual size_t memoryUsage() const {
+		const size_t entry = sizeof(Real) + sizeof(Index);
+		size_t bytes = LinearSolver::memoryUsage()
+				+ box.size() * sizeof(Index);
+		for(const Subdomain &s : subdomains) {
+			bytes += s.nodes.size() * sizeof(Index);
+			if(s.factorization) {
+				bytes += (s.factorization->nnzL()
+						+ s.factorization->nnzU()) * entry;
+			}
+		}
+		if(coarse && A.rows() > 0) {
+			bytes += (coarseFactorization.nnzL()
+					+ coarseFactorization.nnzU()) * entry;
+		}
+		return bytes;
+	}
+
+};
+
+typedef SchwarzSolver<1> SchwarzSolver1;
+typedef SchwarzSolver<2> SchwarzSolver2;
+typedef SchwarzSolver<3> SchwarzSolver3;
+
+} // QuantPDE
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef QUANT_PDE_CORE_SNAPSHOT_HPP
+#define QUANT_PDE_CORE_SNAPSHOT_HPP
+
+namespace QuantPDE {
+
+/**
+ * Receives solutions at intermediate times of a time iteration (e.g. to build
+ * exposure profiles from the values at each coupon date).
+ *
+ * @see QuantPDE::TimeIteration::snapshot
+ * @see QuantPDE::MappedSnapshotWriter
+ */
+class SnapshotSink {
+
+public:
+
+	/**
+	 * Destructor.
+	 */
+	virtual ~SnapshotSink() {
+	}
+
+	/**
+	 * Receives the solution at a requested time. The solution is a view of
+	 * the iterand of the time iteration; it is only valid during the call.
+	 * @param time The time.
+	 * @param solution The solution on the domain nodes.
+	 */
+	virtual void write(Real time, const Vector &solution) = 0;
+
+};
+
+} // QuantPDE
+
+#endif
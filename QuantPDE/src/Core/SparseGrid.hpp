@@ -0,0 +1,264 @@
+#ifndef QUANT_PDE_CORE_SPARSE_GRID_HPP
+#define QUANT_PDE_CORE_SPARSE_GRID_HPP
+
+#include <array>   // std::array
+#include <cassert> // assert
+#include <memory>  // std::unique_ptr
+#include <utility> // std::move
+#include <vector>  // std::vector
+
+namespace QuantPDE {
+
+/**
+ * An interpolant given by a linear combination of interpolants.
+ */
+template <Index Dimension>
+class CombinedInterpolant : public Interpolant<Dimension> {
+
+	typedef std::unique_ptr<Interpolant<Dimension>> I;
+
+	std::vector<Real> coefficients;
+	std::vector<I> interpolants;
+
+public:
+
+	/**
+	 * Constructor.
+	 */
+	CombinedInterpolant() noexcept {
+	}
+
+	/**
+	 * Copy constructor.
+	 */
+	CombinedInterpolant(const CombinedInterpolant &that)
+			: coefficients(that.coefficients) {
+		interpolants.reserve(that.interpolants.size());
+		for(const I &p : that.interpolants) {
+			interpolants.push_back(p->clone());
+		}
+	}
+
+	CombinedInterpolant &operator=(const CombinedInterpolant &) = delete;
+
+	/**
+	 * Adds a term to the combination.
+	 * @param coefficient The coefficient.
+	 * @param interpolant The interpolant.
+	 */
+	void add(Real coefficient, I interpolant) {
+		coefficients.push_back(coefficient);
+		interpolants.push_back(std::move(interpolant));
+	}
+
+	virtual Real interpolate(const std::array<Real, Dimension> &coordinates)
+			const {
+		Real interpolated = 0.;
+		for(size_t k = 0; k < interpolants.size(); ++k) {
+			interpolated += coefficients[k]
+					* interpolants[k]->interpolate(
+					coordinates);
+		}
+		return interpolated;
+	}
+
+	virtual I clone() const {
+		return I(new CombinedInterpolant(*this));
+	}
+
+};
+
+/**
+ * The sparse grid combination technique @cite griebel1992combination.
+ *
+ * Starting from a (coarse) base grid, a level vector \f$\ell\f$ (with
+ * nonnegative entries) describes the anisotropic grid obtained by refining the
+ * \f$d\f$-th axis of the base grid \f$\ell_d\f$ times. The combination
+ * technique of level \f$n\f$ approximates the solution on the (full) grid
+ * refined \f$n\f$ times along each axis by
+ * \f[
+ * 	\sum_{q=0}^{D-1} \left(-1\right)^q \binom{D-1}{q}
+ * 	\sum_{\left|\ell\right|_1 = n - q} u_\ell
+ * \f]
+ * where \f$u_\ell\f$ is the solution on the grid with level vector
+ * \f$\ell\f$. Each grid has \f$O(2^n)\f$ nodes up to logarithmic factors, as
+ * opposed to \f$O(2^{nD})\f$ for the full grid.
+ *
+ * Since the problems on each grid are independent, they are solved in
+ * parallel.
+ */
+template <Index Dimension>
+class CombinationTechnique {
+
+	struct Component {
+		std::array<int, Dimension> levels;
+		Real coefficient;
+		RectilinearGrid<Dimension> grid;
+	};
+
+	const int n;
+	std::vector<Component> components;
+
+	static RectilinearGrid<Dimension> grid(
+		const RectilinearGrid<Dimension> &base,
+		const std::array<int, Dimension> &levels
+	) {
+		std::vector<Axis> axes;
+		axes.reserve(Dimension);
+		for(Index d = 0; d < Dimension; ++d) {
+			axes.push_back(RectilinearGrid1(base[d])
+					.refined(levels[d])[0]);
+		}
+		return RectilinearGrid<Dimension>(axes.data());
+	}
+
+	// Adds the grids with |levels|_1 = sum
+	void enumerate(
+		const RectilinearGrid<Dimension> &base,
+		Real coefficient,
+		std::array<int, Dimension> &levels,
+		Index d,
+		int remaining
+	) {
+		if(d == Dimension - 1) {
+			levels[d] = remaining;
+			components.push_back(Component {
+				levels,
+				coefficient,
+				grid(base, levels)
+			});
+			return;
+		}
+
+		for(int l = 0; l <= remaining; ++l) {
+			levels[d] = l;
+			enumerate(base, coefficient, levels, d + 1,
+					remaining - l);
+		}
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param base The base grid.
+	 * @param level The level \f$n\f$ (at least the dimension minus one).
+	 */
+	CombinationTechnique(const RectilinearGrid<Dimension> &base, int level)
+			: n(level) {
+		if(level < Dimension - 1) {
+			throw "error: the level of the combination technique "
+					"must be at least the dimension minus one";
+		}
+
+		// Binomial coefficients (D - 1 choose q)
+		Real binomial = 1.;
+		std::array<int, Dimension> levels;
+		for(Index q = 0; q < Dimension; ++q) {
+			const Real coefficient = (q % 2 ? -1. : 1.) * binomial;
+			enumerate(base, coefficient, levels, 0, level - q);
+			binomial = binomial * (Dimension - 1 - q) / (q + 1);
+		}
+	}
+
+	// Disable copy constructor and assignment operator.
+	CombinationTechnique(const CombinationTechnique &) = delete;
+	CombinationTechnique &operator=(const CombinationTechnique &) = delete;
+
+	/**
+	 * @return The level.
+	 */
+	int level() const {
+		return n;
+	}
+
+	/**
+	 * @return The number of grids.
+	 */
+	Index size() const {
+		return components.size();
+	}
+
+	/**
+	 * @param k The index of a grid.
+	 * @return The k-th grid.
+	 */
+	const RectilinearGrid<Dimension> &operator[](Index k) const {
+		return components[k].grid;
+	}
+
+	/**
+	 * @param k The index of a grid.
+	 * @return The number of times each axis of the base grid was refined to
+	 *         obtain the k-th grid.
+	 */
+	const std::array<int, Dimension> &levels(Index k) const {
+		return components[k].levels;
+	}
+
+	/**
+	 * @param k The index of a grid.
+	 * @return The coefficient of the solution on the k-th grid.
+	 */
+	Real coefficient(Index k) const {
+		return components[k].coefficient;
+	}
+
+	/**
+	 * @return The total number of nodes on all grids.
+	 */
+	Index nodes() const {
+		Index total = 0;
+		for(const Component &component : components) {
+			total += component.grid.size();
+		}
+		return total;
+	}
+
+	/**
+	 * Solves the problem on each grid and combines the solutions.
+	 *
+	 * The example below prices an option on a basket of three assets:
+	 * \code{.cpp}
+	 * CombinationTechnique3 technique(grid, 4);
+	 * auto V = technique.solve( [&] (const RectilinearGrid3 &G) {
+	 * 	// Everything in here is created per grid (since the solves
+	 * 	// run concurrently)
+	 * 	ReverseConstantStepper stepper(0., T, dt);
+	 * 	Operator op(G, ...);
+	 * 	ReverseRannacher discretization(G, op);
+	 * 	discretization.setIteration(stepper);
+	 * 	BiCGSTABSolver solver;
+	 * 	return stepper.solve(G, payoff, discretization, solver);
+	 * } );
+	 * \endcode
+	 * @param solve Called with each grid and returns the solution on that
+	 *              grid (as an interpolant). It is called from several
+	 *              threads and should not throw.
+	 * @return The combined solution.
+	 */
+	template <typename F>
+	CombinedInterpolant<Dimension> solve(F &&solve) const {
+		std::vector<std::unique_ptr<Interpolant<Dimension>>> solutions(
+				components.size());
+
+		parallelFor(0, components.size(), [&] (Index k) {
+			solutions[k] = solve(components[k].grid).clone();
+		});
+
+		CombinedInterpolant<Dimension> combined;
+		for(size_t k = 0; k < components.size(); ++k) {
+			combined.add(components[k].coefficient,
+					std::move(solutions[k]));
+		}
+		return combined;
+	}
+
+};
+
+typedef CombinationTechnique<2> CombinationTechnique2;
+typedef CombinationTechnique<3> CombinationTechnique3;
+
+} // QuantPDE
+
+#endif
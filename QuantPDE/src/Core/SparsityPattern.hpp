@@ -0,0 +1,170 @@
+#ifndef QUANT_PDE_CORE_SPARSITY_PATTERN_HPP
+#define QUANT_PDE_CORE_SPARSITY_PATTERN_HPP
+
+#include <algorithm> // std::copy, std::fill, std::sort, std::unique
+#include <cassert>   // assert
+#include <limits>    // std::numeric_limits
+#include <utility>   // std::forward
+#include <vector>    // std::vector
+
+namespace QuantPDE {
+
+/**
+ * The positions of the nonzero entries of a (row-major) sparse matrix.
+ *
+ * Operators whose stencil does not change between timesteps compute the
+ * pattern once and then only fill in the values, one row per task, in
+ * parallel:
+ * \code{.cpp}
+ * SparsityPattern pattern(G.size(), [&] (Index i, std::vector<Index> &c) {
+ * 	// Columns of row i (in any order)
+ * 	...
+ * } );
+ * Matrix M = pattern.assemble( [&] (Index i, SparsityPattern::Row &row) {
+ * 	row(i) += ...;
+ * 	row(i - 1) -= ...;
+ * } );
+ * \endcode
+ */
+class SparsityPattern {
+
+	Index n, m;
+	std::vector<Index> outer, inner;
+
+public:
+
+	/**
+	 * The entries of a row.
+	 */
+	class Row {
+
+		const Index *columns;
+		Real *values;
+		Index size;
+
+	public:
+
+		/**
+		 * Constructor.
+		 * @param columns The (sorted) columns of the entries.
+		 * @param values The values of the entries.
+		 * @param size The number of entries.
+		 */
+		Row(const Index *columns, Real *values, Index size) noexcept
+				: columns(columns), values(values), size(size) {
+		}
+
+		/**
+		 * @param j A column in the pattern of this row.
+		 * @return The value of the entry in the j-th column.
+		 */
+		Real &operator()(Index j) {
+			// Rows are short; a linear search is fastest
+			Index k = 0;
+			while(k < size && columns[k] != j) {
+				++k;
+			}
+			assert(k < size);
+			return values[k];
+		}
+
+	};
+
+	/**
+	 * Constructor.
+	 * @param rows The number of rows.
+	 * @param cols The number of columns.
+	 * @param columns Called with a row index and a vector to which it
+	 *                appends the columns of the nonzero entries of that row
+	 *                (duplicates are ignored).
+	 */
+	template <typename F>
+	SparsityPattern(Index rows, Index cols, F &&columns) : n(rows), m(cols)
+			{
+		outer.reserve(n + 1);
+		outer.push_back(0);
+
+		std::vector<Index> row;
+		for(Index i = 0; i < n; ++i) {
+			row.clear();
+			columns(i, row);
+			std::sort(row.begin(), row.end());
+			row.erase(std::unique(row.begin(), row.end()), row.end());
+			assert(row.empty() || (row.front() >= 0
+					&& row.back() < m));
+
+			// Make sure the number of nonzeros is representable (see
+			// QUANT_PDE_64BIT_INDEX)
+			if(inner.size() + row.size() > static_cast<size_t>(
+					std::numeric_limits<Index>::max())) {
+				throw "error: the number of nonzeros does not fit in "
+						"the index type";
+			}
+
+			inner.insert(inner.end(), row.begin(), row.end());
+			outer.push_back(inner.size());
+		}
+	}
+
+	/**
+	 * Constructor for square matrices.
+	 * @param rows The number of rows (and columns).
+	 * @param columns See the constructor above.
+	 */
+	template <typename F>
+	SparsityPattern(Index rows, F &&columns) : SparsityPattern(rows, rows,
+			std::forward<F>(columns)) {
+	}
+
+	/**
+	 * @return The number of rows.
+	 */
+	Index rows() const {
+		return n;
+	}
+
+	/**
+	 * @return The number of columns.
+	 */
+	Index cols() const {
+		return m;
+	}
+
+	/**
+	 * @return The number of nonzero entries.
+	 */
+	Index nonZeros() const {
+		return inner.size();
+	}
+
+	/**
+	 * Creates a (compressed) matrix with this pattern. The rows are filled
+	 * in parallel.
+	 * @param fill Called with a row index and the (zero-initialized)
+	 *             entries of that row. It is called from several threads.
+	 * @return The matrix.
+	 */
+	template <typename F>
+	Matrix assemble(F &&fill) const {
+		Matrix M(n, m);
+		M.resizeNonZeros(inner.size());
+		std::copy(outer.begin(), outer.end(), M.outerIndexPtr());
+		std::copy(inner.begin(), inner.end(), M.innerIndexPtr());
+
+		Real *values = M.valuePtr();
+		parallelFor(0, n, [&] (Index i) {
+			const Index begin = outer[i], size = outer[i + 1] - begin;
+			std::fill(values + begin, values + begin + size, 0.);
+
+			Row row(inner.data() + begin, values + begin, size);
+			fill(i, row);
+		});
+
+		return M;
+	}
+
+};
+
+} // QuantPDE
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef QUANT_PDE_CORE_STENCIL_MATRIX_HPP
+#define QUANT_PDE_CORE_STENCIL_MATRIX_HPP
+
+#include <algorithm> // std::max, std::min, std::sort
+#include <cassert>   // assert
+#include <utility>   // std::move
+#include <vector>    // std::vector
+
+namespace QuantPDE {
+
+/**
+ * A square matrix whose nonzero entries lie on a fixed set of diagonals, stored
+ * as one array of values per diagonal (i.e. the DIA format).
+ *
+ * Operators on a rectilinear grid couple each node only to the nodes a fixed
+ * distance away in the ordering (e.g. \f$\pm 1\f$, \f$\pm n_1\f$,
+ * \f$\pm n_1 n_2\f$, ...). Storing these diagonals avoids loading a column
+ * index per nonzero entry, and matrix-vector products run over contiguous
+ * arrays:
+ * \code{.cpp}
+ * StencilMatrix M(G.size(), {-1, 0, 1});
+ * M.insert(i, i - 1) = -alpha;
+ * M.insert(i, i)     =  alpha + beta;
+ * M.insert(i, i + 1) = -beta;
+ * Vector y = multiply(M, x); // Products in DIA format
+ * Matrix A = M.matrix();     // Conversion for direct solvers
+ * \endcode
+ *
+ * Entries of a diagonal that fall outside of the matrix (e.g. the entry of the
+ * first row on the diagonal with offset -1) are ignored.
+ *
+ * @see QuantPDE::multiply(const StencilMatrix &, const Vector &, Vector &)
+ */
+class StencilMatrix {
+
+	Index n;
+	std::vector<Index> offsets_;
+	std::vector<Vector> diagonals;
+
+public:
+
+	/**
+	 * Constructor. The entries are initialized to zero (in parallel, if
+	 * first touch is enabled).
+	 * @param size The number of rows (and columns).
+	 * @param offsets The offsets of the diagonals (column minus row).
+	 */
+	StencilMatrix(Index size, std::vector<Index> offsets) : n(size),
+			offsets_(std::move(offsets)) {
+		assert(n >= 0);
+		checkNonzeros(n, offsets_.size());
+		diagonals.reserve(offsets_.size());
+		for(size_t k = 0; k < offsets_.size(); ++k) {
+			diagonals.emplace_back(n);
+			fill(diagonals.back(), 0.);
+		}
+	}
+
+	/**
+	 * @return The number of rows.
+	 */
+	Index rows() const {
+		return n;
+	}
+
+	/**
+	 * @return The number of columns.
+	 */
+	Index cols() const {
+		return n;
+	}
+
+	/**
+	 * @return The offsets of the diagonals.
+	 */
+	const std::vector<Index> &offsets() const {
+		return offsets_;
+	}
+
+	/**
+	 * @param k The index of a diagonal (in the order of the offsets).
+	 * @return The entries of the diagonal; the i-th is that of the i-th row.
+	 */
+	Vector &diagonal(Index k) {
+		return diagonals[k];
+	}
+
+	/**
+	 * @param k The index of a diagonal (in the order of the offsets).
+	 * @return The entries of the diagonal; the i-th is that of the i-th row.
+	 */
+	const Vector &diagonal(Index k) const {
+		return diagonals[k];
+	}
+
+	/**
+	 * @param i The row.
+	 * @param j The column.
+	 * @return The entry (zero if it lies off the diagonals).
+	 */
+	Real coeff(Index i, Index j) const {
+		if(i < 0 || i >= n || j < 0 || j >= n) {
+			throw "error: entry is outside of the matrix";
+		}
+
+		const Index offset = j - i;
+		for(size_t k = 0; k < offsets_.size(); ++k) {
+			if(offsets_[k] == offset) {
+				return diagonals[k](i);
+			}
+		}
+		return 0.;
+	}
+
+	/**
+	 * Diagonals that are not already stored (e.g. the one reached by a
+	 * one-sided difference in a boundary routine) are added, zeroed, on
+	 * demand. This invalidates references to the diagonals, and so should
+	 * not be done while other threads are filling the matrix.
+	 * @param i The row.
+	 * @param j The column.
+	 * @return A reference to the entry.
+	 */
+	Real &coeffRef(Index i, Index j) {
+		if(i < 0 || i >= n || j < 0 || j >= n) {
+			throw "error: entry is outside of the matrix";
+		}
+
+		// There are few diagonals; a linear search is fastest
+		const Index offset = j - i;
+		size_t k = 0;
+		while(k < offsets_.size() && offsets_[k] != offset) {
+			++k;
+		}
+		if(k == offsets_.size()) {
+			checkNonzeros(n, offsets_.size() + 1);
+			offsets_.push_back(offset);
+			diagonals.emplace_back(n);
+			fill(diagonals.back(), 0.);
+		}
+		return diagonals[k](i);
+	}
+
+	/**
+	 * Equivalent to coeffRef, so that code filling a Matrix entry by entry
+	 * also fills a StencilMatrix.
+	 * @param i The row.
+	 * @param j The column.
+	 * @return A reference to the entry.
+	 */
+	Real &insert(Index i, Index j) {
+		return coeffRef(i, j);
+	}
+
+	/**
+	 * Sets all entries to zero.
+	 */
+	void setZero() {
+		for(auto &d : diagonals) {
+			fill(d, 0.);
+		}
+	}
+
+	/**
+	 * @return The matrix in compressed row-major format (entries that are
+	 *         exactly zero are dropped).
+	 */
+	Matrix matrix() const {
+		// Diagonals in increasing order of offsets, so that the columns
+		// of each row are sorted
+		std::vector<size_t> order(offsets_.size());
+		for(size_t k = 0; k < order.size(); ++k) {
+			order[k] = k;
+		}
+		std::sort(order.begin(), order.end(), [&] (size_t a, size_t b) {
+			return offsets_[a] < offsets_[b];
+		});
+
+		Matrix M(n, n);
+		M.reserve( nonzerosPerRow(n, offsets_.size()) );
+		for(Index i = 0; i < n; ++i) {
+			for(size_t k : order) {
+				const Index j = i + offsets_[k];
+				const Real value = diagonals[k](i);
+				if(j >= 0 && j < n && value != 0.) {
+					M.insert(i, j) = value;
+				}
+			}
+		}
+		M.makeCompressed();
+		return M;
+	}
+
+};
+
+/**
+ * Computes \f$y=Ax\f$ in parallel. The rows are split evenly into contiguous
+ * blocks, one per thread, and each block is pinned to its thread; within a
+ * block, each diagonal is applied in turn as a (vectorized) elementwise
+ * product. Each entry of the result sums the diagonals in the same order, so
+ * that the result does not depend on the number of threads.
+ * @param A The matrix.
+ * @param x The vector (not aliased by the result).
+ * @param y The result.
+ * @see QuantPDE::setThreads
+ * @see QuantPDE::setMultiplyGrain
+ */
+inline void multiply(const StencilMatrix &A, const Vector &x, Vector &y) {
+	assert(A.cols() == x.size());
+	assert(&x != &y);
+
+	const Index n = A.rows();
+	y.resize(n);
+
+	const std::vector<Index> &offsets = A.offsets();
+	const Index count = multiplyBlocks(n * offsets.size());
+
+	parallelBlocks(count, [&] (Index k) {
+		const Index first = (n * k) / count;
+		const Index last  = (n * (k + 1)) / count;
+
+		y.segment(first, last - first).setZero();
+		for(size_t d = 0; d < offsets.size(); ++d) {
+			const Index o = offsets[d];
+			const Index a = std::max<Index>(first, -o);
+			const Index b = std::min<Index>(last, n - o);
+			if(b <= a) {
+				continue;
+			}
+			y.segment(a, b - a).array() += A.diagonal(d).segment(a,
+					b - a).array() * x.segment(a + o,
+					b - a).array();
+		}
+	});
+}
+
+/**
+ * Computes \f$Ax\f$ in parallel.
+ * @param A The matrix.
+ * @param x The vector.
+ * @return The product.
+ * @see QuantPDE::multiply(const StencilMatrix &, const Vector &, Vector &)
+ */
+inline Vector multiply(const StencilMatrix &A, const Vector &x) {
+	Vector y;
+	multiply(A, x, y);
+	return y;
+}
+
+} // QuantPDE
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef QUANT_PDE_LIBRARY_EXTERN_TEMPLATES_HPP
+#define QUANT_PDE_LIBRARY_EXTERN_TEMPLATES_HPP
+
+// Templates pre-instantiated in the quantpde library. Each macro expands to
+// explicit instantiation definitions, or, if PREFIX is extern, to explicit
+// instantiation declarations (see QUANT_PDE_EXTERN_TEMPLATES).
+
+#define QUANT_PDE_LIBRARY_DIMENSION_TEMPLATES(PREFIX, D) \
+	PREFIX template class Domain<D>; \
+	PREFIX template class RectilinearGrid<D>; \
+	PREFIX template class Interpolant<D>; \
+	PREFIX template class InterpolantWrapper<D>; \
+	PREFIX template class InterpolantFactory<D>; \
+	PREFIX template class InterpolantFactoryWrapper<D>; \
+	PREFIX template class PiecewiseLinear<D>; \
+	PREFIX template class AdaptiveGrid<D>; \
+	PREFIX template class AdaptivePiecewiseLinear<D>; \
+	PREFIX template class Map<D>; \
+	PREFIX template class MapWrapper<D>; \
+	PREFIX template class PointwiseMap<D>; \
+	PREFIX template class Event<D>; \
+	PREFIX template class SchwarzSolver<D>; \
+	PREFIX template class ControlledLinearSystem<D>; \
+	PREFIX template class RawControlledLinearSystem<D, 1>; \
+	PREFIX template class RawControlledLinearSystem<D, 2>; \
+	PREFIX template class RawControlledLinearSystem<D, 3>; \
+	PREFIX template class PolicyIteration<D, 1, false>; \
+	PREFIX template class PolicyIteration<D, 2, false>; \
+	PREFIX template class PolicyIteration<D, 3, false>; \
+	PREFIX template class PolicyIteration<D, 1, true>; \
+	PREFIX template class PolicyIteration<D, 2, true>; \
+	PREFIX template class PolicyIteration<D, 3, true>; \
+	PREFIX template class Impulse<D, 1>; \
+	PREFIX template class Impulse<D, 2>; \
+	PREFIX template class Impulse<D, 3>; \
+	PREFIX template class PenaltyMethodDifference<false, D>; \
+	PREFIX template class PenaltyMethodDifference<true, D>;
+
+#define QUANT_PDE_LIBRARY_DIRECTION_TEMPLATES(PREFIX, FORWARD) \
+	PREFIX template class TimeIteration<FORWARD>; \
+	PREFIX template class ConstantStepper<FORWARD>; \
+	PREFIX template class VariableStepper<FORWARD>; \
+	PREFIX template class CrankNicolson<FORWARD>; \
+	PREFIX template class Rannacher<FORWARD>; \
+	PREFIX template class DouglasADI<FORWARD>; \
+	PREFIX template class BDFOne<FORWARD>; \
+	PREFIX template class BDFTwo<FORWARD>;
+
+/**
+ * Core templates for dimensions 1 to 3 and both directions of time.
+ */
+#define QUANT_PDE_CORE_TEMPLATES(PREFIX) \
+	PREFIX template class CircularBuffer<std::tuple<Real, Vector>>; \
+	PREFIX template class PenaltyMethod<false>; \
+	PREFIX template class PenaltyMethod<true>; \
+	PREFIX template class BlockRelaxationSolver<false>; \
+	PREFIX template class BlockRelaxationSolver<true>; \
+	PREFIX template class AuxiliaryEvent<2, 1>; \
+	PREFIX template class AuxiliaryEvent<3, 2>; \
+	QUANT_PDE_LIBRARY_DIMENSION_TEMPLATES(PREFIX, 1) \
+	QUANT_PDE_LIBRARY_DIMENSION_TEMPLATES(PREFIX, 2) \
+	QUANT_PDE_LIBRARY_DIMENSION_TEMPLATES(PREFIX, 3) \
+	QUANT_PDE_LIBRARY_DIRECTION_TEMPLATES(PREFIX, false) \
+	QUANT_PDE_LIBRARY_DIRECTION_TEMPLATES(PREFIX, true)
+
+/**
+ * Operator templates.
+ */
+#define QUANT_PDE_MODULES_OPERATORS_TEMPLATES(PREFIX) \
+	PREFIX template class BlackScholes<1, 0>; \
+	PREFIX template class MultiAssetBlackScholes<2>; \
+	PREFIX template class MultiAssetBlackScholes<3>;
+
+#endif
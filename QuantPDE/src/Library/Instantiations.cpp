@@ -0,0 +1,27 @@
+////////////////////////////////////////////////////////////////////////////////
+// Instantiations.cpp
+// ------------------
+//
+// Explicit instantiations compiled into the quantpde library. Code linking
+// against the library should define QUANT_PDE_EXTERN_TEMPLATES so that these
+// templates are not instantiated again in each translation unit.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef QUANT_PDE_EXTERN_TEMPLATES
+#undef QUANT_PDE_EXTERN_TEMPLATES
+#endif
+
+#include <QuantPDE/Core>
+#include <QuantPDE/Modules/Operators>
+
+namespace QuantPDE {
+
+QUANT_PDE_CORE_TEMPLATES()
+
+namespace Modules {
+
+QUANT_PDE_MODULES_OPERATORS_TEMPLATES()
+
+} // Modules
+
+} // QuantPDE
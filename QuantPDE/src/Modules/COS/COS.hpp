@@ -0,0 +1,345 @@
+#ifndef QUANT_PDE_MODULES_COS_HPP
+#define QUANT_PDE_MODULES_COS_HPP
+
+#include <cassert>    // assert
+#include <cmath>      // std::cos, std::exp, std::log, std::sin, std::sqrt
+#include <complex>    // std::complex, std::exp
+#include <functional> // std::function
+#include <utility>    // std::move
+#include <vector>     // std::vector
+
+namespace QuantPDE {
+
+namespace Modules {
+
+/**
+ * An exponential Lévy model of an asset under the risk-neutral measure. The
+ * log-return \f$X_t = \ln\left(S_t / S_0\right)\f$ has characteristic
+ * function \f$E\left[e^{iuX_t}\right] = e^{t\psi\left(u\right)}\f$.
+ *
+ * @see QuantPDE::Modules::COS
+ */
+struct LevyModel {
+
+	/**
+	 * The characteristic exponent \f$\psi\f$.
+	 */
+	std::function<std::complex<Real> (Real)> exponent;
+
+	/**
+	 * The first, second, and fourth cumulants of \f$X_1\f$ (those of
+	 * \f$X_t\f$ are \f$t\f$ times these).
+	 */
+	Real c1, c2, c4;
+
+	/**
+	 * The risk-free interest rate and the continuous dividend rate.
+	 */
+	Real r, q;
+
+};
+
+/**
+ * @param interest The risk-free interest rate.
+ * @param volatility The volatility.
+ * @param dividends The continuous dividend rate.
+ * @return The model of BlackScholes (a lognormal asset).
+ */
+inline LevyModel lognormalModel(Real interest, Real volatility,
+		Real dividends = 0.) {
+	assert(volatility > 0.);
+
+	const Real s2 = volatility * volatility;
+	const Real mu = interest - dividends - s2 / 2.;
+
+	return LevyModel {
+		[mu, s2] (Real u) {
+			return std::complex<Real>(-s2 * u * u / 2., mu * u);
+		},
+		mu, s2, 0.,
+		interest, dividends
+	};
+}
+
+/**
+ * @param interest The risk-free interest rate.
+ * @param volatility The volatility.
+ * @param dividends The continuous dividend rate.
+ * @param meanArrivalTime The mean arrival time of the Poisson process.
+ * @param mu The mean of the logarithm of the jump amplitude.
+ * @param sigma The standard deviation of the logarithm of the jump amplitude.
+ * @return Merton's jump-diffusion model (the jump amplitude has the density
+ *         lognormal(mu, sigma)).
+ * @see QuantPDE::Modules::lognormal
+ */
+inline LevyModel mertonModel(Real interest, Real volatility, Real dividends,
+		Real meanArrivalTime, Real mu, Real sigma) {
+	assert(volatility > 0.);
+	assert(meanArrivalTime >= 0.);
+	assert(sigma > 0.);
+
+	const Real s2 = volatility * volatility;
+	const Real lambda = meanArrivalTime;
+	const Real kappa = std::exp(mu + sigma * sigma / 2.) - 1.;
+	const Real drift = interest - dividends - s2 / 2. - lambda * kappa;
+
+	const Real m2 = mu * mu, v = sigma * sigma;
+
+	return LevyModel {
+		[=] (Real u) {
+			const std::complex<Real> jump = std::exp(
+					std::complex<Real>(-v * u * u / 2.,
+					mu * u)) - 1.;
+			return std::complex<Real>(-s2 * u * u / 2., drift * u)
+					+ lambda * jump;
+		},
+		drift + lambda * mu,
+		s2 + lambda * (m2 + v),
+		lambda * (m2 * m2 + 6. * m2 * v + 3. * v * v),
+		interest, dividends
+	};
+}
+
+/**
+ * @param interest The risk-free interest rate.
+ * @param volatility The volatility.
+ * @param dividends The continuous dividend rate.
+ * @param meanArrivalTime The mean arrival time of the Poisson process.
+ * @param p Probability of upward jump.
+ * @param eta_1 The upward jump random variable has mean 1/eta_1.
+ * @param eta_2 The downward jump random variable has mean 1/eta_2.
+ * @return Kou's double exponential jump-diffusion model (the jump amplitude
+ *         has the density doubleExponential(p, eta_1, eta_2)).
+ * @see QuantPDE::Modules::doubleExponential
+ */
+inline LevyModel kouModel(Real interest, Real volatility, Real dividends,
+		Real meanArrivalTime, Real p, Real eta_1, Real eta_2) {
+	assert(volatility > 0.);
+	assert(meanArrivalTime >= 0.);
+	assert(p >= 0. && p <= 1.);
+	assert(eta_1 > 1.); // Ensures finite expectation
+	assert(eta_2 > 0.);
+
+	const Real s2 = volatility * volatility;
+	const Real lambda = meanArrivalTime;
+	const Real kappa = p * eta_1 / (eta_1 - 1.)
+			+ (1. - p) * eta_2 / (eta_2 + 1.) - 1.;
+	const Real drift = interest - dividends - s2 / 2. - lambda * kappa;
+
+	auto power = [] (Real x, int n) {
+		Real y = 1.;
+		for(int i = 0; i < n; ++i) {
+			y *= x;
+		}
+		return y;
+	};
+
+	return LevyModel {
+		[=] (Real u) {
+			const std::complex<Real> iu(0., u);
+			const std::complex<Real> jump = p * eta_1
+					/ (eta_1 - iu) + (1. - p) * eta_2
+					/ (eta_2 + iu) - 1.;
+			return std::complex<Real>(-s2 * u * u / 2., drift * u)
+					+ lambda * jump;
+		},
+		drift + lambda * (p / eta_1 - (1. - p) / eta_2),
+		s2 + 2. * lambda * (p / power(eta_1, 2)
+				+ (1. - p) / power(eta_2, 2)),
+		24. * lambda * (p / power(eta_1, 4)
+				+ (1. - p) / power(eta_2, 4)),
+		interest, dividends
+	};
+}
+
+/**
+ * Prices European options by the Fourier-cosine (COS) method
+ * @cite fang2008novel .
+ *
+ * The density of the logarithm of the asset at expiry is truncated to an
+ * interval \f$\left[a, b\right]\f$ (of width \f$2L\f$ standard deviations,
+ * roughly) and expanded in a cosine series whose coefficients are read off of
+ * the characteristic function. The price of a payoff is then a dot product of
+ * these coefficients with the cosine coefficients of the payoff; prices of
+ * several payoffs (e.g. a strip of strikes) are a single matrix-vector
+ * product.
+ *
+ * The cosine coefficients of puts and calls are computed exactly (calls are
+ * priced by put-call parity, which is more robust to the truncation). Those of
+ * other payoffs, such as those in Payoffs.hpp, are computed with Simpson's
+ * rule on the log-asset; the error of the latter is dominated by kinks and
+ * jumps of the payoff (first order in the spacing for jumps, such as those of
+ * digital options).
+ *
+ * Since it costs a handful of microseconds per strike, it is also well suited
+ * for reference values in convergence tests of the PDE solvers.
+ *
+ * @see QuantPDE::Modules::LevyModel
+ */
+class COS {
+
+	typedef Eigen::Matrix<Real, Eigen::Dynamic, Eigen::Dynamic> Dense;
+
+	const LevyModel model;
+	const Real T;
+	const Index N, M;
+	Real lower, upper; // Of the log-return
+
+	// Simpson's rule for general payoffs: weights times the cosines at the
+	// nodes (which do not depend on the spot)
+	Dense quadrature;
+
+	// The terms of the series without the payoff coefficients
+	Vector series(Real spot, Real &a, Real &b) const {
+		const Real x0 = std::log(spot);
+		a = x0 + lower;
+		b = x0 + upper;
+
+		Vector F(N);
+		for(Index k = 0; k < N; ++k) {
+			const Real u = k * M_PI / (b - a);
+			const std::complex<Real> phi = std::exp( T
+					* model.exponent(u)
+					+ std::complex<Real>(0., -u * lower) );
+			F(k) = phi.real();
+		}
+		F(0) /= 2.;
+
+		// Discount and normalize
+		return F * std::exp(-model.r * T) * 2. / (b - a);
+	}
+
+	// Coefficients of puts: integrals of (K - e^x) cos(u_k (x - a)) over
+	// [a, min(log K, b)]
+	Dense putCoefficients(const std::vector<Real> &strikes, Real a, Real b)
+			const {
+		Dense C(N, strikes.size());
+		for(size_t j = 0; j < strikes.size(); ++j) {
+			const Real K = strikes[j];
+			assert(K > 0.);
+
+			const Real d = std::log(K) < b ? std::log(K) : b;
+			if(d <= a) {
+				C.col(j).setZero();
+				continue;
+			}
+
+			const Real ea = std::exp(a), ed = std::exp(d);
+			for(Index k = 0; k < N; ++k) {
+				const Real u = k * M_PI / (b - a);
+				const Real c = std::cos(u * (d - a));
+				const Real s = std::sin(u * (d - a));
+
+				// Integrals of e^x cos(...) and cos(...)
+				const Real chi = (c * ed - ea + u * s * ed)
+						/ (1. + u * u);
+				const Real psi = k == 0 ? d - a : s / u;
+
+				C(k, j) = K * psi - chi;
+			}
+		}
+		return C;
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param model The model.
+	 * @param expiry The time to expiry.
+	 * @param terms The number of terms in the cosine series.
+	 * @param L The half-width of the truncated domain (in units of
+	 *          standard deviation, roughly).
+	 * @param quadraturePoints The number of intervals of Simpson's rule for
+	 *                         general payoffs (even).
+	 */
+	COS(LevyModel model, Real expiry, Index terms = 256, Real L = 10.,
+			Index quadraturePoints = 4096) : model(std::move(model)),
+			T(expiry), N(terms), M(quadraturePoints) {
+		assert(T > 0.);
+		assert(N > 0);
+		assert(M > 0 && M % 2 == 0);
+
+		const Real c1 = this->model.c1 * T;
+		const Real c2 = this->model.c2 * T;
+		const Real c4 = this->model.c4 * T;
+
+		const Real width = L * std::sqrt(c2 + std::sqrt(c4));
+		lower = c1 - width;
+		upper = c1 + width;
+
+		const Real h = (upper - lower) / M;
+		quadrature = Dense(N, M + 1);
+		for(Index i = 0; i <= M; ++i) {
+			const Real w = (i == 0 || i == M ? 1. : (i % 2 ? 4. : 2.))
+					* h / 3.;
+			for(Index k = 0; k < N; ++k) {
+				quadrature(k, i) = w * std::cos(k * M_PI * i / M);
+			}
+		}
+	}
+
+	/**
+	 * @param spot The initial value of the asset.
+	 * @param strikes The strikes.
+	 * @return The prices of puts with the given strikes.
+	 */
+	Vector puts(Real spot, const std::vector<Real> &strikes) const {
+		Real a, b;
+		const Vector F = series(spot, a, b);
+		return putCoefficients(strikes, a, b).transpose() * F;
+	}
+
+	/**
+	 * @param spot The initial value of the asset.
+	 * @param strikes The strikes.
+	 * @return The prices of calls with the given strikes.
+	 */
+	Vector calls(Real spot, const std::vector<Real> &strikes) const {
+		Vector V = puts(spot, strikes);
+		const Real forward = spot * std::exp(-model.q * T);
+		const Real discount = std::exp(-model.r * T);
+		for(size_t j = 0; j < strikes.size(); ++j) {
+			V(j) += forward - strikes[j] * discount;
+		}
+		return V;
+	}
+
+	/**
+	 * @param spot The initial value of the asset.
+	 * @param payoffs The payoffs (functions of the asset at expiry).
+	 * @return The prices of the payoffs.
+	 */
+	Vector operator()(Real spot, const std::vector<Function1> &payoffs)
+			const {
+		Real a, b;
+		const Vector F = series(spot, a, b);
+
+		// Payoffs at the nodes
+		const Real h = (b - a) / M;
+		Dense P(M + 1, payoffs.size());
+		for(size_t j = 0; j < payoffs.size(); ++j) {
+			for(Index i = 0; i <= M; ++i) {
+				P(i, j) = payoffs[j]( std::exp(a + i * h) );
+			}
+		}
+
+		return (quadrature * P).transpose() * F;
+	}
+
+	/**
+	 * @param spot The initial value of the asset.
+	 * @param payoff The payoff (a function of the asset at expiry).
+	 * @return The price of the payoff.
+	 */
+	Real operator()(Real spot, const Function1 &payoff) const {
+		return (*this)(spot, std::vector<Function1> {payoff})(0);
+	}
+
+};
+
+} // Modules
+
+} // QuantPDE
+
+#endif
@@ -10,7 +10,7 @@
 #include <iomanip>          // std::setw
 #include <initializer_list> // std::initializer_list
 #include <limits>           // std::numeric_limits
-#include <memory>           // std::forward, std::unique_ptr
+#include <memory>           // std::forward, std::shared_ptr, std::unique_ptr
 #include <numeric>          // std::accumulate
 #include <string>           // std::string
 #include <tuple>            // std::make_tuple
@@ -78,6 +78,14 @@ struct Result {
 
 	const Real execution_time_seconds;
 
+	// Null unless HJBQVI::recordPolicyHistory was called; the k-th record
+	// is the policy at time time(k), with records in decreasing time
+	const std::shared_ptr<const PolicyHistory> stochastic_policy_history;
+	const std::shared_ptr<const PolicyHistory> impulse_policy_history;
+
+	// Memory used by the solve (iterands, nodes, linear solver and peaks)
+	const MemoryReport memory;
+
 	Result(
 		const RectilinearGrid<Dimension> &spatial_grid,
 		const RectilinearGrid<StochasticControlDimension>
@@ -96,7 +104,13 @@ struct Result {
 		Real mean_inner_iterations,
 		Real mean_solver_iterations,
 
-		Real execution_time_seconds
+		Real execution_time_seconds,
+
+		std::shared_ptr<const PolicyHistory> stochastic_policy_history
+				= nullptr,
+		std::shared_ptr<const PolicyHistory> impulse_policy_history
+				= nullptr,
+		const MemoryReport &memory = MemoryReport()
 	) noexcept :
 		spatial_grid(spatial_grid),
 		stochastic_control_grid(stochastic_control_grid),
@@ -112,7 +126,11 @@ struct Result {
 		mean_inner_iterations(mean_inner_iterations),
 		mean_solver_iterations(mean_solver_iterations),
 
-		execution_time_seconds(execution_time_seconds)
+		execution_time_seconds(execution_time_seconds),
+
+		stochastic_policy_history(stochastic_policy_history),
+		impulse_policy_history(impulse_policy_history),
+		memory(memory)
 	{
 		for(Index i = 0; i < StochasticControlDimension; ++i) {
 			this->stochastic_control_vector[i] =
@@ -137,7 +155,7 @@ struct ControlledOperator final : public RawControlledLinearSystem<
 	const HJBQVI hjbqvi;
 	RectilinearGrid<Dimension> refined_spatial_grid;
 
-	int offsets[Dimension];
+	Index offsets[Dimension];
 
 	template <typename H, typename R>
 	ControlledOperator(
@@ -149,23 +167,20 @@ struct ControlledOperator final : public RawControlledLinearSystem<
 	{
 		// Space between ticks
 		offsets[0] = 1;
-		for(int d = 1; d < Dimension; ++d) {
+		for(Index d = 1; d < Dimension; ++d) {
 			offsets[d] = offsets[d-1]
 					* refined_spatial_grid[d-1].size();
 		}
 	}
 
-	virtual Matrix A(Real time) {
-		Matrix A = refined_spatial_grid.matrix();
-
-		// Reserve nonzero entries per row
+	StencilMatrix stencil(Real time) {
 		// Each dimension requires at most 2 cells (i.e. i-1 and i+1)
-		A.reserve(
-			IntegerVector::Constant(
-				refined_spatial_grid.size(),
-				1 + 2 * Dimension
-			)
-		);
+		std::vector<Index> diagonals { 0 };
+		for(int d = 0; d < Dimension; ++d) {
+			diagonals.push_back(-offsets[d]);
+			diagonals.push_back( offsets[d]);
+		}
+		StencilMatrix A(refined_spatial_grid.size(), diagonals);
 
 		// Control as a vector
 		Vector q[StochasticControlDimension];
@@ -176,9 +191,9 @@ struct ControlledOperator final : public RawControlledLinearSystem<
 		}
 
 		// Iterate through points on grid
-		int i[Dimension];
+		Index i[Dimension];
 		Real args[1+Dimension+StochasticControlDimension];
-		for(int row = 0; row < refined_spatial_grid.size(); ++row) {
+		for(Index row = 0; row < refined_spatial_grid.size(); ++row) {
 			Real total = 0.;
 
 			// Get coordinates of point
@@ -282,10 +297,17 @@ struct ControlledOperator final : public RawControlledLinearSystem<
 			A.insert(row, row) = total + rho;
 		}
 
-		A.makeCompressed();
 		return A;
 	}
 
+	virtual Matrix A(Real time) {
+		return stencil(time).matrix();
+	}
+
+	virtual Vector Ax(Real time, const Vector &x) {
+		return multiply(stencil(time), x);
+	}
+
 	virtual Vector b(Real time) {
 		Vector b = refined_spatial_grid.vector();
 
@@ -298,9 +320,9 @@ struct ControlledOperator final : public RawControlledLinearSystem<
 		}
 
 		// Iterate through points on grid
-		int i[Dimension];
+		Index i[Dimension];
 		Real args[1+Dimension+StochasticControlDimension];
-		for(int row = 0; row < refined_spatial_grid.size(); ++row) {
+		for(Index row = 0; row < refined_spatial_grid.size(); ++row) {
 
 			// Get coordinates of point
 			args[0] = time; // Time
@@ -352,16 +374,18 @@ class ExplicitEvent : public EventBase {
 			&refined_impulse_control_grid;
 	Vector (&stochastic_control_vector)[StochasticControlDimension];
 	Vector (&impulse_control_vector)[ImpulseControlDimension];
-	Real time, dt;
+	const Iteration &clock; // The event occurs at clock.nextTime()
+	Real dt;
 	std::vector<bool> &mask;
 
-	int offsets[Dimension];
+	Index offsets[Dimension];
 
 	template <typename V>
 	Vector _doEvent(V &&vector) const {
 
 		mask.clear();
 
+		const Real time = clock.nextTime();
 		Vector best = refined_spatial_grid.vector();
 
 		PiecewiseLinear<Dimension> u(refined_spatial_grid, vector);
@@ -376,8 +400,8 @@ class ExplicitEvent : public EventBase {
 				: ImpulseControlDimension
 			)
 		];
-		int i[Dimension];
-		for(int row = 0; row < refined_spatial_grid.size(); ++row) {
+		Index i[Dimension];
+		for(Index row = 0; row < refined_spatial_grid.size(); ++row) {
 
 		////////////////////////////////////////////////////////////////
 		// begin row loop
@@ -556,7 +580,7 @@ public:
 		I &refined_impulse_control_grid,
 		Vector (&stochastic_control_vector)[StochasticControlDimension],
 		Vector (&impulse_control_vector)[ImpulseControlDimension],
-		Real time,
+		const Iteration &clock,
 		Real dt,
 		std::vector<bool> &mask
 	) noexcept :
@@ -567,13 +591,13 @@ public:
 		refined_impulse_control_grid(refined_impulse_control_grid),
 		stochastic_control_vector(stochastic_control_vector),
 		impulse_control_vector(impulse_control_vector),
-		time(time),
+		clock(clock),
 		dt(dt),
 		mask(mask)
 	{
 		// Space between ticks
 		offsets[0] = 1;
-		for(int d = 1; d < Dimension; ++d) {
+		for(Index d = 1; d < Dimension; ++d) {
 			offsets[d] = offsets[d-1]
 					* refined_spatial_grid[d-1].size();
 		}
@@ -581,6 +605,22 @@ public:
 
 };
 
+class RecordEvent : public DoEvent {
+
+	std::function<void ()> record;
+
+	virtual void onCall(const Vector &) const {
+		record();
+	}
+
+public:
+
+	template <typename F>
+	RecordEvent(F &&record) noexcept : record(std::forward<F>(record)) {
+	}
+
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Methods
 ////////////////////////////////////////////////////////////////////////////////
@@ -753,27 +793,89 @@ Result solve(int refinement = 0) const {
 		root = &penalty;
 	}
 
-	// Add events
-	if(!this->fully_implicit()) {
-		for(int e = 0; e < timesteps; ++e) {
-			const Real time = e * dt;
+	// Record policies
+	// In reverse time, events added later at the same time are handled
+	// first, so these must be added before the explicit events
+	std::shared_ptr<PolicyHistory> stochastic_policy_history;
+	std::shared_ptr<PolicyHistory> impulse_policy_history;
+	if(record_policy_history && finite_horizon) {
+		const std::string &path = policy_history_path;
+		stochastic_policy_history = std::make_shared<PolicyHistory>(
+			refined_spatial_grid.size(),
+			path.empty() ? path : path + ".stochastic",
+			policy_history_keyframe_interval
+		);
+		impulse_policy_history = std::make_shared<PolicyHistory>(
+			refined_spatial_grid.size(),
+			path.empty() ? path : path + ".impulse",
+			policy_history_keyframe_interval
+		);
 
-			stepper->add(
+		auto record = [&] (Real time) {
+			// Implicit controls live in the linear systems
+			if(!this->semi_lagrangian()) {
+				for(int d = 0; d < StochasticControlDimension;
+						++d) {
+					stochastic_control_vector[d] =
+						controlled_operator.control(d);
+				}
+			}
+
+			if(!this->explicit_impulse()) {
+				for(int d = 0; d < ImpulseControlDimension;
+						++d) {
+					impulse_control_vector[d] =
+							impulse.control(d);
+				}
+				mask = penalty.constraintMask();
+			}
+
+			stochastic_policy_history->push(
 				time,
-				std::unique_ptr<EventBase>(
-					new ExplicitEvent(
-						*this,
-						refined_spatial_grid,
-						refined_stochastic_control_grid,
-						refined_impulse_control_grid,
-						stochastic_control_vector,
-						impulse_control_vector,
-						time,
-						dt,
-						mask
-					)
+				PolicyHistory::encode(
+					refined_stochastic_control_grid,
+					stochastic_control_vector,
+					&mask,
+					true
 				)
 			);
+			impulse_policy_history->push(
+				time,
+				PolicyHistory::encode(
+					refined_impulse_control_grid,
+					impulse_control_vector,
+					&mask,
+					false
+				)
+			);
+		};
+
+		// One event, scheduled at each timestep
+		const Iteration *clock = stepper.get();
+		const std::shared_ptr<EventBase> event = std::make_shared<
+				RecordEvent>( [=] { record(clock->nextTime()); } );
+		for(int e = 0; e < timesteps; ++e) {
+			stepper->add(e * dt, event);
+		}
+	}
+
+	// Add events
+	if(!this->fully_implicit()) {
+		// One event, scheduled at each timestep
+		const std::shared_ptr<EventBase> event = std::make_shared<
+				ExplicitEvent>(
+			*this,
+			refined_spatial_grid,
+			refined_stochastic_control_grid,
+			refined_impulse_control_grid,
+			stochastic_control_vector,
+			impulse_control_vector,
+			*stepper,
+			dt,
+			mask
+		);
+		for(int e = 0; e < timesteps; ++e) {
+			stepper->add(e * dt, event);
 		}
 	}
 
@@ -793,6 +895,7 @@ Result solve(int refinement = 0) const {
 
 	// Solution
 	Vector solution_vector;
+	MemoryReport memory;
 
 	// Timing
 	Real seconds;
@@ -810,6 +913,7 @@ Result solve(int refinement = 0) const {
 			*solver
 		);
 		solution_vector = refined_spatial_grid.image(u);
+		memory = iteration->memoryReport();
 
 	#ifdef QUANT_PDE_MODULES_HJBQVI_ITERATED_OPTIMAL_STOPPING
 	} else {
@@ -975,7 +1079,7 @@ Result solve(int refinement = 0) const {
 			0.) / its.size();
 
 	// Apply mask
-	for(int i = 0; i < refined_spatial_grid.size(); ++i) {
+	for(Index i = 0; i < refined_spatial_grid.size(); ++i) {
 		if(mask[i]) {
 			// Impulse control IS active here
 			for(int d = 0; d < StochasticControlDimension; ++d) {
@@ -1012,7 +1116,11 @@ Result solve(int refinement = 0) const {
 		mean_inner_iterations,
 		mean_solver_iterations,
 
-		seconds
+		seconds,
+
+		stochastic_policy_history,
+		impulse_policy_history,
+		memory
 	);
 
 }
@@ -1053,6 +1161,8 @@ Result solve(int refinement = 0) const {
 	const Real scaling_factor;
 	const Real iteration_tolerance;
 
+	// Boundary routines fill their row of the matrix in DIA format (entries
+	// off the interior stencil add a diagonal)
 	typedef std::function< Real (
 		const HJBQVI &,
 		const RectilinearGrid<Dimension> &,
@@ -1060,7 +1170,7 @@ Result solve(int refinement = 0) const {
 		const Real (&)[1+Dimension+StochasticControlDimension],
 		const Index (&)[Dimension],
 		const Index (&)[Dimension],
-		Matrix &, Index
+		StencilMatrix &, Index
 	) > boundary_routine;
 
 private:
@@ -1080,6 +1190,10 @@ private:
 
 	int refinement_mask;
 
+	bool record_policy_history;
+	std::string policy_history_path;
+	int policy_history_keyframe_interval;
+
 public:
 
 	template <typename R>
@@ -1198,7 +1312,10 @@ public:
 
 		drop_semi_lagrangian_off_grid(false),
 
-		refinement_mask(0)
+		refinement_mask(0),
+
+		record_policy_history(false),
+		policy_history_keyframe_interval(32)
 	{
 		// TODO: Proper exceptions
 
@@ -1265,6 +1382,35 @@ public:
 	void useSparseLUSolver() { solver = HJBQVISolver::SPARSE_LU; }
 	void doNotRefineAxis(int k) { refinement_mask |= (1 << k); }
 
+	/**
+	 * Records the policy at every timestep of a finite horizon problem
+	 * (see Result::stochastic_policy_history).
+	 * @param path If nonempty, the histories are written to path
+	 *             suffixed by ".stochastic" and ".impulse" instead of being
+	 *             kept in memory (only supported on POSIX platforms).
+	 * @param keyframe_interval The maximum number of timesteps between
+	 *                          full (i.e., not delta-encoded) records.
+	 */
+	void recordPolicyHistory(const std::string &path = "",
+			int keyframe_interval = 32) {
+		if(target_timestep_relative_error > 0.) {
+			throw "error: policy history can not be recorded with"
+					" variable timesteps";
+		}
+		if(keyframe_interval <= 0) {
+			throw "error: keyframe interval must be positive";
+		}
+		#ifndef QUANT_PDE_POLICY_HISTORY_FILE
+		if(!path.empty()) {
+			throw "error: policy history files are only supported "
+					"on POSIX platforms";
+		}
+		#endif
+		record_policy_history = true;
+		policy_history_path = path;
+		policy_history_keyframe_interval = keyframe_interval;
+	}
+
 };
 
 #define QUANT_PDE_MODULES_HJBQVI_BOUNDARY_SIGNATURE \
@@ -1273,9 +1419,9 @@ public:
 	const RectilinearGrid<Dimension> &refined_spatial_grid, \
 	Index d, \
 	const Real (&args)[1+Dimension+StochasticControlDimension], \
-	const int (&i)[Dimension], \
+	const Index (&i)[Dimension], \
 	const Index (&offsets)[Dimension], \
-	Matrix &A, Index row
+	StencilMatrix &A, Index row
 
 template <
 	Index Dimension,
@@ -1443,7 +1589,7 @@ typename HJBQVI<
 			}
 			out << std::endl;
 
-			int k = 0;
+			Index k = 0;
 			for(auto node : result.spatial_grid) {
 				for(int d = 0; d < Dimension; ++d) {
 					out << space() << node[d];
@@ -0,0 +1,443 @@
+#ifndef QUANT_PDE_MODULES_HJBQVI_POLICY_HISTORY_HPP
+#define QUANT_PDE_MODULES_HJBQVI_POLICY_HISTORY_HPP
+
+#include <algorithm> // std::lower_bound
+#include <cassert>   // assert
+#include <cmath>     // std::isnan, std::nan
+#include <cstdint>   // std::uint32_t
+#include <cstdlib>   // std::abs, size_t
+#include <limits>    // std::numeric_limits
+#include <string>    // std::string
+#include <vector>    // std::vector
+
+// File storage is only available on POSIX platforms
+#if defined(__unix__) || defined(__APPLE__)
+#define QUANT_PDE_POLICY_HISTORY_FILE
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, munmap
+#include <unistd.h>   // close, write
+#endif
+
+namespace QuantPDE {
+
+namespace Modules {
+
+/**
+ * Records a discrete policy (at each spatial node, a node of a control grid or
+ * nothing at all) at every timestep of a solve.
+ *
+ * Each record is a vector of codes, one per spatial node, where a code is the
+ * index of a node on the control grid (or PolicyHistory::inactive). Since
+ * policies tend to change slowly between timesteps, a record is stored as a
+ * list of (node, old code XOR new code) pairs relative to the previous record.
+ * A full record (keyframe) is stored every so often (or whenever it is smaller
+ * than the delta) so that any record can be recovered in a bounded number of
+ * steps. Because the deltas are XORs, they can be applied in both directions;
+ * walking the records in either order with a Cursor costs only the number of
+ * changes.
+ *
+ * Codes are either kept in memory or (on POSIX platforms) appended to a file
+ * which is memory-mapped when read.
+ */
+class PolicyHistory {
+
+public:
+
+	typedef std::uint32_t Code;
+
+	/**
+	 * Code for a node at which the control is not active.
+	 */
+	static constexpr Code inactive = std::numeric_limits<Code>::max();
+
+private:
+
+	struct Record {
+		Real time;
+		size_t offset, length;
+		int keyframe; // Index of the keyframe this record is built from
+	};
+
+	const size_t n;
+	const int interval;
+
+	std::vector<Record> records;
+	std::vector<Code> last;
+
+	// In-memory storage
+	std::vector<Code> buffer;
+
+	// File storage
+	int fd;
+	size_t stored;
+	mutable const Code *mapped;
+	mutable size_t mappedLength;
+
+	void append(const Code *codes, size_t length) {
+		if(fd < 0) {
+			buffer.insert(buffer.end(), codes, codes + length);
+		}
+		#ifdef QUANT_PDE_POLICY_HISTORY_FILE
+		else {
+			const char *p = (const char *) codes;
+			size_t remaining = length * sizeof(Code);
+			while(remaining > 0) {
+				const ssize_t written = ::write(fd, p, remaining);
+				if(written < 0) {
+					throw "error: could not write policy "
+							"history";
+				}
+				p += written;
+				remaining -= written;
+			}
+		}
+		#endif
+		stored += length;
+	}
+
+	void unmap() const {
+		#ifdef QUANT_PDE_POLICY_HISTORY_FILE
+		if(mapped) {
+			munmap((void *) mapped, mappedLength * sizeof(Code));
+			mapped = nullptr;
+			mappedLength = 0;
+		}
+		#endif
+	}
+
+	const Code *data() const {
+		if(fd < 0) {
+			return buffer.data();
+		}
+
+		#ifdef QUANT_PDE_POLICY_HISTORY_FILE
+		// Remap if the file has grown since it was last mapped
+		if(mappedLength != stored) {
+			unmap();
+			void *p = mmap(nullptr, stored * sizeof(Code),
+					PROT_READ, MAP_SHARED, fd, 0);
+			if(p == MAP_FAILED) {
+				throw "error: could not map policy history";
+			}
+			mapped = (const Code *) p;
+			mappedLength = stored;
+		}
+		#endif
+
+		return mapped;
+	}
+
+	void apply(int k, std::vector<Code> &codes) const {
+		const Record &record = records[k];
+		const Code *p = data() + record.offset;
+		if(record.keyframe == k) {
+			codes.assign(p, p + record.length);
+		} else {
+			for(size_t i = 0; i < record.length; i += 2) {
+				codes[ p[i] ] ^= p[i + 1];
+			}
+		}
+	}
+
+public:
+
+	/**
+	 * Walks the records of a history. Stepping to an adjacent record costs
+	 * only the number of nodes whose codes differ between the two.
+	 */
+	class Cursor {
+
+		const PolicyHistory *history;
+		std::vector<Code> codes;
+		int position;
+
+	public:
+
+		/**
+		 * Constructor.
+		 * @param history The history to walk.
+		 */
+		Cursor(const PolicyHistory &history) noexcept
+				: history(&history), position(-1) {
+		}
+
+		/**
+		 * @param k The index of a record.
+		 * @return The codes of the k-th record.
+		 */
+		const std::vector<Code> &seek(int k) {
+			assert(k >= 0);
+			assert(k < history->size());
+
+			const int keyframe = history->records[k].keyframe;
+
+			if(position >= keyframe && position <= k) {
+				// Walk forward
+				while(position < k) {
+					history->apply(++position, codes);
+				}
+			} else if(
+				position > k
+				&& history->records[position].keyframe
+						== keyframe
+			) {
+				// Walk backward (XOR deltas are involutions)
+				while(position > k) {
+					history->apply(position--, codes);
+				}
+			} else {
+				// Jump to the keyframe and walk forward
+				position = keyframe;
+				history->apply(position, codes);
+				while(position < k) {
+					history->apply(++position, codes);
+				}
+			}
+
+			return codes;
+		}
+
+	};
+
+	/**
+	 * Constructor.
+	 * @param nodes The number of spatial nodes in each record.
+	 * @param path If nonempty, codes are written to this file (which is
+	 *             truncated) and memory-mapped when read. This is only
+	 *             supported on POSIX platforms; elsewhere, an exception is
+	 *             thrown.
+	 * @param interval The maximum number of records between keyframes.
+	 */
+	PolicyHistory(
+		size_t nodes,
+		const std::string &path = "",
+		int interval = 32
+	) :
+		n(nodes),
+		interval(interval),
+		fd(-1),
+		stored(0),
+		mapped(nullptr),
+		mappedLength(0)
+	{
+		assert(interval > 0);
+
+		// Node indices are stored as codes in deltas
+		assert(nodes < inactive);
+
+		if(!path.empty()) {
+			#ifdef QUANT_PDE_POLICY_HISTORY_FILE
+			fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+					0644);
+			if(fd < 0) {
+				throw "error: could not open policy history "
+						"file";
+			}
+			#else
+			throw "error: policy history files are only supported "
+					"on POSIX platforms";
+			#endif
+		}
+	}
+
+	/**
+	 * Destructor.
+	 */
+	virtual ~PolicyHistory() {
+		unmap();
+		#ifdef QUANT_PDE_POLICY_HISTORY_FILE
+		if(fd >= 0) {
+			close(fd);
+		}
+		#endif
+	}
+
+	// Disable copy constructor and assignment operator.
+	PolicyHistory(const PolicyHistory &) = delete;
+	PolicyHistory &operator=(const PolicyHistory &) = delete;
+
+	/**
+	 * Appends a record.
+	 * @param time The time associated with the record.
+	 * @param codes One code for each spatial node.
+	 */
+	void push(Real time, const std::vector<Code> &codes) {
+		assert(codes.size() == n);
+
+		Record record;
+		record.time = time;
+		record.offset = stored;
+
+		// Count changes to decide between a delta and a keyframe
+		size_t changes = 0;
+		const int k = records.size();
+		const bool canDelta = k > 0
+				&& k - records.back().keyframe < interval;
+		if(canDelta) {
+			for(size_t i = 0; i < n; ++i) {
+				if(codes[i] != last[i]) {
+					++changes;
+				}
+			}
+		}
+
+		if(canDelta && 2 * changes < n) {
+			std::vector<Code> delta;
+			delta.reserve(2 * changes);
+			for(size_t i = 0; i < n; ++i) {
+				if(codes[i] != last[i]) {
+					delta.push_back(i);
+					delta.push_back(codes[i] ^ last[i]);
+				}
+			}
+			record.length = delta.size();
+			record.keyframe = records.back().keyframe;
+			append(delta.data(), delta.size());
+		} else {
+			record.length = n;
+			record.keyframe = k;
+			append(codes.data(), n);
+		}
+
+		records.push_back(record);
+		last = codes;
+	}
+
+	/**
+	 * @return The number of records.
+	 */
+	int size() const {
+		return records.size();
+	}
+
+	/**
+	 * @return The number of spatial nodes in each record.
+	 */
+	size_t nodes() const {
+		return n;
+	}
+
+	/**
+	 * @param k The index of a record.
+	 * @return The time associated with the k-th record.
+	 */
+	Real time(int k) const {
+		return records[k].time;
+	}
+
+	/**
+	 * @return The number of bytes used to store the codes.
+	 */
+	size_t bytes() const {
+		return stored * sizeof(Code);
+	}
+
+	/**
+	 * @param k The index of a record.
+	 * @return The codes of the k-th record.
+	 */
+	std::vector<Code> at(int k) const {
+		Cursor cursor(*this);
+		return cursor.seek(k);
+	}
+
+	/**
+	 * Encodes a policy.
+	 * @param grid The control grid.
+	 * @param controls The controls (one vector per control dimension); each
+	 *                 value is expected to be a tick on the corresponding
+	 *                 axis of the control grid.
+	 * @param mask The control is inactive where the mask is equal to
+	 *             inactiveWhen (ignored if null).
+	 * @param inactiveWhen See mask.
+	 * @return One code for each spatial node.
+	 */
+	template <Index ControlDimension>
+	static std::vector<Code> encode(
+		const RectilinearGrid<ControlDimension> &grid,
+		const Vector (&controls)[ControlDimension],
+		const std::vector<bool> *mask = nullptr,
+		bool inactiveWhen = true
+	) {
+		const Index size = controls[0].size();
+		std::vector<Code> codes(size);
+
+		for(Index i = 0; i < size; ++i) {
+			if(mask && (*mask)[i] == inactiveWhen) {
+				codes[i] = inactive;
+				continue;
+			}
+
+			Code code = 0, stride = 1;
+			for(Index d = 0; d < ControlDimension; ++d) {
+				const Axis &axis = grid[d];
+				const Real q = controls[d](i);
+
+				if(std::isnan(q)) {
+					code = inactive;
+					break;
+				}
+
+				// Closest tick
+				const Real *ticks = axis.ticks();
+				Index j = std::lower_bound(ticks,
+						ticks + axis.size(), q) - ticks;
+				if(j == axis.size() || (j > 0 && q - ticks[j-1]
+						< ticks[j] - q)) {
+					--j;
+				}
+
+				code += stride * j;
+				stride *= axis.size();
+			}
+
+			codes[i] = code;
+		}
+
+		return codes;
+	}
+
+	/**
+	 * Decodes one dimension of a policy.
+	 * @param grid The control grid.
+	 * @param codes One code for each spatial node.
+	 * @param d The control dimension.
+	 * @return The control values (NaN where the control is inactive).
+	 */
+	template <Index ControlDimension>
+	static Vector decode(
+		const RectilinearGrid<ControlDimension> &grid,
+		const std::vector<Code> &codes,
+		Index d
+	) {
+		Vector v(codes.size());
+		for(size_t i = 0; i < codes.size(); ++i) {
+			v(i) = codes[i] == inactive
+					? std::nan("")
+					: grid.coordinates(codes[i])[d];
+		}
+		return v;
+	}
+
+	/**
+	 * @param grid The control grid.
+	 * @param k The index of a record.
+	 * @param d The control dimension.
+	 * @return The control values of the k-th record.
+	 */
+	template <Index ControlDimension>
+	Vector control(
+		const RectilinearGrid<ControlDimension> &grid,
+		int k,
+		Index d
+	) const {
+		return decode(grid, at(k), d);
+	}
+
+};
+
+} // namespace Modules
+
+} // namespace QuantPDE
+
+#endif
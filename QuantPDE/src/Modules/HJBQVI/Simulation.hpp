@@ -0,0 +1,576 @@
+#ifndef QUANT_PDE_MODULES_HJBQVI_SIMULATION_HPP
+#define QUANT_PDE_MODULES_HJBQVI_SIMULATION_HPP
+
+#include <algorithm> // std::fill, std::max, std::min, std::upper_bound
+#include <array>     // std::array
+#include <cassert>   // assert
+#include <cmath>     // std::exp, std::sqrt, std::round
+#include <memory>    // std::shared_ptr, std::unique_ptr
+#include <random>    // std::mt19937_64, std::normal_distribution
+#include <vector>    // std::vector
+
+namespace QuantPDE {
+
+namespace Modules {
+
+/**
+ * Simulates paths forward in time under the policy computed by an HJBQVI
+ * solve.
+ *
+ * At each timestep, the policy is interpolated multilinearly within the cell
+ * of the spatial grid containing each path, using the corners at which the
+ * control is active. The impulse is applied (accruing the impulse flow) if the
+ * corners at which it is active carry at least half of the weight, after which
+ * the policy is interpolated again at the new state. If the stochastic control
+ * is inactive at every corner (i.e. the state is still in the intervention
+ * region), the first node of the control grid is used. The state is then
+ * advanced by an Euler-Maruyama step (with an
+ * independent Brownian motion for each spatial dimension) under the
+ * stochastic control, accruing the continuous flow and the discount. The exit
+ * function is accrued at the expiry.
+ *
+ * If the policy history was recorded (see HJBQVI::recordPolicyHistory), the
+ * policy of each timestep is used; otherwise, the policy at the initial time
+ * is used throughout.
+ *
+ * Paths are simulated in batches (stored as structures of arrays) spread over
+ * threads. Within a batch, the cells, corner weights and interpolated controls
+ * of all paths are computed together, one loop over the batch per corner,
+ * before the model functions are called path by path. Each batch has its own
+ * random number generator seeded by the seed and the batch index, so that
+ * results do not depend on the number of threads.
+ */
+template <
+	Index Dimension = 1,
+	Index StochasticControlDimension = 1,
+	Index ImpulseControlDimension = 1
+>
+class HJBQVISimulation {
+
+public:
+
+	typedef HJBQVI<
+		Dimension,
+		StochasticControlDimension,
+		ImpulseControlDimension
+	> Problem;
+
+	typedef typename Problem::Result Solution;
+
+	struct Statistics {
+		const int paths;
+		const Real mean;
+		const Real standard_error;
+		const Real mean_impulses;
+
+		// Empty unless HJBQVISimulation::keepPathValues was called
+		const std::vector<Real> path_values;
+	};
+
+private:
+
+	typedef PolicyHistory::Code Code;
+
+	const Problem problem;
+	const Solution solution;
+
+	int timesteps;
+	Real dt;
+
+	Index strides[Dimension];
+
+	// Index of the record for each timestep (if the history was recorded)
+	std::vector<int> record_at;
+
+	// Policy at the initial time (used if the history was not recorded)
+	std::vector<Code> initial_stochastic_codes;
+	std::vector<Code> initial_impulse_codes;
+
+	// Coordinates of the nodes of the control grids
+	std::vector<Real> stochastic_nodes[StochasticControlDimension];
+	std::vector<Real> impulse_nodes[ImpulseControlDimension];
+
+	int batch_size;
+	bool keep_path_values;
+	bool nearest_node;
+
+	struct Policy {
+		const std::vector<Code> &fallback;
+		const std::vector<int> &record_at;
+		std::unique_ptr<PolicyHistory::Cursor> cursor;
+
+		Policy(
+			const std::shared_ptr<const PolicyHistory> &history,
+			const std::vector<Code> &fallback,
+			const std::vector<int> &record_at
+		) :
+			fallback(fallback),
+			record_at(record_at)
+		{
+			if(history) {
+				cursor = std::unique_ptr<PolicyHistory::Cursor>(
+						new PolicyHistory::Cursor(
+						*history));
+			}
+		}
+
+		const std::vector<Code> &at(int n) {
+			return cursor ? cursor->seek(record_at[n]) : fallback;
+		}
+	};
+
+	// Lower node of the cell containing x and the weight of the upper node
+	void locate(const Axis &axis, Real x, Index &j, Real &w) const {
+		const Real *ticks = axis.ticks();
+		const Index n = axis.size();
+		if(n < 2) {
+			j = 0;
+			w = 0.;
+			return;
+		}
+
+		j = std::upper_bound(ticks, ticks + n, x) - ticks - 1;
+		j = std::max<Index>(0, std::min<Index>(j, n - 2));
+		w = (x - ticks[j]) / (ticks[j+1] - ticks[j]);
+		w = std::max<Real>(0., std::min<Real>(w, 1.));
+		if(nearest_node) {
+			w = w < 0.5 ? 0. : 1.;
+		}
+	}
+
+	// Coordinates of each node of a control grid (one array per dimension)
+	template <Index ControlDimension>
+	static void tabulate(
+		const RectilinearGrid<ControlDimension> &grid,
+		std::vector<Real> (&nodes)[ControlDimension]
+	) {
+		for(Index d = 0; d < ControlDimension; ++d) {
+			nodes[d].resize(grid.size());
+		}
+		for(Index k = 0; k < grid.size(); ++k) {
+			const auto coordinates = grid.coordinates(k);
+			for(Index d = 0; d < ControlDimension; ++d) {
+				nodes[d][k] = coordinates[d];
+			}
+		}
+	}
+
+	// Interpolates the control of each path of a batch over the corners of
+	// its cell at which the control is active, and sets active to the total
+	// weight of those corners. The corners are visited in the outer loop,
+	// so that the loops over paths have no branches on the corner.
+	template <Index ControlDimension>
+	void interpolate(
+		const std::vector<Code> &codes,
+		const std::vector<Real> (&nodes)[ControlDimension],
+		const std::vector<Index> (&lower)[Dimension],
+		const std::vector<Real> (&weight)[Dimension],
+		std::vector<Real> &corner,
+		std::vector<Index> &node,
+		std::vector<Real> (&value)[ControlDimension],
+		std::vector<Real> &active
+	) const {
+		const size_t size = active.size();
+
+		for(Index d = 0; d < ControlDimension; ++d) {
+			std::fill(value[d].begin(), value[d].end(), 0.);
+		}
+		std::fill(active.begin(), active.end(), 0.);
+
+		for(Index c = 0; c < ((Index) 1 << Dimension); ++c) {
+			// Weights and indices of this corner
+			std::fill(corner.begin(), corner.end(), 1.);
+			std::fill(node.begin(), node.end(), 0);
+			for(Index d = 0; d < Dimension; ++d) {
+				const Real *w = weight[d].data();
+				const Index *l = lower[d].data();
+				const Index stride = strides[d];
+				if(c & ((Index) 1 << d)) {
+					for(size_t p = 0; p < size; ++p) {
+						corner[p] *= w[p];
+						node[p] += stride * (l[p] + 1);
+					}
+				} else {
+					for(size_t p = 0; p < size; ++p) {
+						corner[p] *= 1. - w[p];
+						node[p] += stride * l[p];
+					}
+				}
+			}
+
+			// Accumulate the controls of the active corners
+			for(size_t p = 0; p < size; ++p) {
+				const Code code = codes[ node[p] ];
+				const bool on = code != PolicyHistory::inactive;
+				const Real a = on ? corner[p] : 0.;
+				const Code k = on ? code : 0;
+				for(Index d = 0; d < ControlDimension; ++d) {
+					value[d][p] += a * nodes[d][k];
+				}
+				active[p] += a;
+			}
+		}
+
+		for(Index d = 0; d < ControlDimension; ++d) {
+			for(size_t p = 0; p < size; ++p) {
+				if(active[p] > 0.) {
+					value[d][p] /= active[p];
+				}
+			}
+		}
+	}
+
+	void simulateBatch(
+		int batch,
+		int size,
+		const std::array<Real, Dimension> &initial_state,
+		unsigned seed,
+		Real *values,
+		long &impulses
+	) const {
+		std::seed_seq sequence{ seed, (unsigned) batch };
+		std::mt19937_64 engine(sequence);
+		std::normal_distribution<Real> normal;
+
+		Policy stochastic(
+			solution.stochastic_policy_history,
+			initial_stochastic_codes,
+			record_at
+		);
+		Policy impulse(
+			solution.impulse_policy_history,
+			initial_impulse_codes,
+			record_at
+		);
+
+		// State (structure of arrays)
+		std::vector<Real> x[Dimension];
+		for(Index d = 0; d < Dimension; ++d) {
+			x[d].assign(size, initial_state[d]);
+		}
+		std::vector<Real> discount(size, 1.);
+		std::vector<Index> lower[Dimension];
+		std::vector<Real> weight[Dimension];
+		for(Index d = 0; d < Dimension; ++d) {
+			lower[d].resize(size);
+			weight[d].resize(size);
+		}
+
+		// Interpolated controls (structure of arrays)
+		std::vector<Real> corner(size);
+		std::vector<Index> node(size);
+		std::vector<Real> stochastic_value[StochasticControlDimension];
+		std::vector<Real> impulse_value[ImpulseControlDimension];
+		std::vector<Real> stochastic_active(size), impulse_active(size);
+		for(Index d = 0; d < StochasticControlDimension; ++d) {
+			stochastic_value[d].resize(size);
+		}
+		for(Index d = 0; d < ImpulseControlDimension; ++d) {
+			impulse_value[d].resize(size);
+		}
+
+		for(int p = 0; p < size; ++p) {
+			values[p] = 0.;
+		}
+
+		const Real sqrt_dt = std::sqrt(dt);
+
+		Real args[
+			1
+			+Dimension
+			+(
+				(StochasticControlDimension
+						> ImpulseControlDimension)
+				? StochasticControlDimension
+				: ImpulseControlDimension
+			)
+		];
+		Real state[Dimension];
+
+		for(int n = 0; n < timesteps; ++n) {
+			const Real time = n * dt;
+
+			// Locate cells
+			for(Index d = 0; d < Dimension; ++d) {
+				const Axis &axis = solution.spatial_grid[d];
+				for(int p = 0; p < size; ++p) {
+					locate(axis, x[d][p], lower[d][p],
+							weight[d][p]);
+				}
+			}
+
+			// Impulse
+			interpolate(
+				impulse.at(n),
+				impulse_nodes,
+				lower,
+				weight,
+				corner,
+				node,
+				impulse_value,
+				impulse_active
+			);
+
+			for(int p = 0; p < size; ++p) {
+				if(impulse_active[p] < 0.5) {
+					continue;
+				}
+
+				args[0] = time;
+				for(Index d = 0; d < Dimension; ++d) {
+					args[1+d] = x[d][p];
+				}
+				for(
+					Index d = 0;
+					d < ImpulseControlDimension;
+					++d
+				) {
+					args[1+Dimension+d] =
+							impulse_value[d][p];
+				}
+
+				values[p] += discount[p] * packAndCall<
+					1
+					+Dimension
+					+ImpulseControlDimension
+				>(problem.impulse_flow, args);
+
+				for(Index d = 0; d < Dimension; ++d) {
+					state[d] = packAndCall<
+						1
+						+Dimension
+						+ImpulseControlDimension
+					>(problem.transition[d], args);
+				}
+				for(Index d = 0; d < Dimension; ++d) {
+					x[d][p] = state[d];
+					locate(solution.spatial_grid[d],
+							state[d], lower[d][p],
+							weight[d][p]);
+				}
+
+				++impulses;
+			}
+
+			// Stochastic control (at the states after the impulses)
+			interpolate(
+				stochastic.at(n),
+				stochastic_nodes,
+				lower,
+				weight,
+				corner,
+				node,
+				stochastic_value,
+				stochastic_active
+			);
+
+			for(int p = 0; p < size; ++p) {
+				args[0] = time;
+				for(Index d = 0; d < Dimension; ++d) {
+					args[1+d] = x[d][p];
+				}
+
+				// If the state is still in the intervention
+				// region, the first node of the control grid is
+				// used
+				const bool on = stochastic_active[p] != 0.;
+				for(
+					Index d = 0;
+					d < StochasticControlDimension;
+					++d
+				) {
+					args[1+Dimension+d] = on
+						? stochastic_value[d][p]
+						: stochastic_nodes[d][0];
+				}
+
+				const Real flow = packAndCall<
+					1
+					+Dimension
+					+StochasticControlDimension
+				>(problem.controlled_continuous_flow, args);
+
+				const Real rho = packAndCall<1+Dimension>(
+						problem.discount, args);
+
+				for(Index d = 0; d < Dimension; ++d) {
+					const Real mu = packAndCall<
+						1
+						+Dimension
+						+StochasticControlDimension
+					>(problem.controlled_drift[d], args);
+
+					const Real v = packAndCall<1+Dimension>(
+							problem.volatility[d], args);
+
+					x[d][p] += mu * dt
+							+ v * sqrt_dt * normal(engine);
+				}
+
+				values[p] += discount[p] * flow * dt;
+				discount[p] *= std::exp(-rho * dt);
+			}
+		}
+
+		// Exit
+		for(int p = 0; p < size; ++p) {
+			args[0] = problem.expiry;
+			for(Index d = 0; d < Dimension; ++d) {
+				args[1+d] = x[d][p];
+			}
+			values[p] += discount[p] * packAndCall<1+Dimension>(
+					problem.exit_function, args);
+		}
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param problem The problem.
+	 * @param solution The result of solving the problem.
+	 */
+	HJBQVISimulation(
+		const Problem &problem,
+		const Solution &solution
+	) :
+		problem(problem),
+		solution(solution),
+		timesteps(solution.timesteps),
+		batch_size(1024),
+		keep_path_values(false),
+		nearest_node(false)
+	{
+		if(timesteps <= 0) {
+			throw "error: only finite horizon problems can be"
+					" simulated";
+		}
+
+		dt = problem.expiry / timesteps;
+
+		strides[0] = 1;
+		for(Index d = 1; d < Dimension; ++d) {
+			strides[d] = strides[d-1]
+					* solution.spatial_grid[d-1].size();
+		}
+
+		initial_stochastic_codes = PolicyHistory::encode(
+			solution.stochastic_control_grid,
+			solution.stochastic_control_vector
+		);
+		initial_impulse_codes = PolicyHistory::encode(
+			solution.impulse_control_grid,
+			solution.impulse_control_vector
+		);
+
+		tabulate(solution.stochastic_control_grid, stochastic_nodes);
+		tabulate(solution.impulse_control_grid, impulse_nodes);
+
+		// Match records to timesteps
+		const auto &history = solution.stochastic_policy_history;
+		if(history) {
+			record_at.assign(timesteps, -1);
+			for(int k = 0; k < history->size(); ++k) {
+				const int n = std::round(history->time(k) / dt);
+				if(n >= 0 && n < timesteps) {
+					record_at[n] = k;
+				}
+			}
+			for(int n = 0; n < timesteps; ++n) {
+				if(record_at[n] < 0) {
+					throw "error: policy history does not"
+							" match the timesteps";
+				}
+			}
+		}
+	}
+
+	/**
+	 * Simulates paths.
+	 * @param initial_state The state at the initial time.
+	 * @param paths The number of paths.
+	 * @param seed The seed.
+	 * @return Statistics of the discounted value of the paths.
+	 */
+	Statistics simulate(
+		const std::array<Real, Dimension> &initial_state,
+		int paths,
+		unsigned seed = 0
+	) const {
+		assert(paths > 0);
+
+		const int batches = (paths + batch_size - 1) / batch_size;
+
+		std::vector<Real> values(paths);
+		std::vector<long> impulses(batches, 0);
+
+		parallelFor(0, batches, [&] (Index batch) {
+			const int first = batch * batch_size;
+			const int size = std::min(batch_size, paths - first);
+			simulateBatch(
+				batch,
+				size,
+				initial_state,
+				seed,
+				values.data() + first,
+				impulses[batch]
+			);
+		});
+
+		// Reduce in order
+		Real sum = 0., sum_of_squares = 0.;
+		long total_impulses = 0;
+		for(int p = 0; p < paths; ++p) {
+			sum += values[p];
+			sum_of_squares += values[p] * values[p];
+		}
+		for(int b = 0; b < batches; ++b) {
+			total_impulses += impulses[b];
+		}
+
+		const Real mean = sum / paths;
+		const Real variance = paths > 1
+				? (sum_of_squares - paths * mean * mean)
+						/ (paths - 1)
+				: 0.;
+
+		return Statistics {
+			paths,
+			mean,
+			std::sqrt(std::max(variance, 0.) / paths),
+			(Real) total_impulses / paths,
+			keep_path_values ? values : std::vector<Real>()
+		};
+	}
+
+	/**
+	 * @param size The number of paths simulated together by one thread.
+	 */
+	void setBatchSize(int size) {
+		if(size <= 0) {
+			throw "error: batch size must be positive";
+		}
+		batch_size = size;
+	}
+
+	/**
+	 * Return the discounted value of each path with the statistics.
+	 */
+	void keepPathValues() { keep_path_values = true; }
+
+	/**
+	 * Look up the policy at the closest node instead of interpolating it.
+	 * Interpolation avoids the first-order bias that the closest node adds
+	 * for continuous controls, but it can produce controls between the
+	 * nodes of the control grid; this is useful if only the controls on the
+	 * grid are admissible (e.g. bang-bang controls).
+	 */
+	void useNearestNode() { nearest_node = true; }
+
+};
+
+} // namespace Modules
+
+} // namespace QuantPDE
+
+#endif
@@ -1,51 +1,62 @@
 #ifndef QUANT_PDE_MODULES_LAMBDAS_PAYOFFS_HPP
 #define QUANT_PDE_MODULES_LAMBDAS_PAYOFFS_HPP
 
+#include <algorithm> // std::max
+#include <cmath>     // std::abs
+
 namespace QuantPDE {
 
 namespace Modules {
 
+// The payoffs below are batch functions, so that they are evaluated on a whole
+// grid at once (e.g. as the initial condition of a solve). They are written
+// without branches so that the batch loops are vectorized.
+
 /**
  * @param K strike price.
- * @return Lambda function payoff for a digital call option, \f$1_{S \geq K}\f$.
+ * @return Payoff for a digital call option, \f$1_{S \geq K}\f$.
  */
-inline Function1 digitalCallPayoff(Real K) {
-	return [K] (Real S) { return S < K ? 0. : 1.; };
+inline BatchFunction1 digitalCallPayoff(Real K) {
+	return BatchFunction1::elementwise(
+			[K] (Real S) { return (Real) (S >= K); } );
 }
 
 /**
  * @param K strike price.
- * @return Lambda function payoff for a digital put option, \f$1_{S \leq K}\f$.
+ * @return Payoff for a digital put option, \f$1_{S \leq K}\f$.
  */
-inline Function1 digitalPutPayoff(Real K) {
-	return [K] (Real S) { return S > K ? 0. : 1.; };
+inline BatchFunction1 digitalPutPayoff(Real K) {
+	return BatchFunction1::elementwise(
+			[K] (Real S) { return (Real) (S <= K); } );
 }
 
 /**
  * @param K Strike price.
- * @return Lambda function payoff for a vanilla call option,
+ * @return Payoff for a vanilla call option,
  *         \f$\left(S\right)\equiv max\left(S - K, 0\right)\f$.
  */
-inline Function1 callPayoff(Real K) {
-	return [K] (Real S) { return S < K ? 0. : S - K; };
+inline BatchFunction1 callPayoff(Real K) {
+	return BatchFunction1::elementwise(
+			[K] (Real S) { return std::max(S - K, 0.); } );
 }
 
 /**
  * @param K Strike price.
- * @return Lambda function payoff for a vanilla put option,
+ * @return Payoff for a vanilla put option,
  *         \f$\left(S\right)\equiv max\left(S - K, 0\right)\f$.
  */
-inline Function1 putPayoff(Real K) {
-	return [K] (Real S) { return S < K ? K - S : 0.; };
+inline BatchFunction1 putPayoff(Real K) {
+	return BatchFunction1::elementwise(
+			[K] (Real S) { return std::max(K - S, 0.); } );
 }
 
 /**
  * @param K Strike price.
- * @return Lambda function payoff for a straddle; the sum of the payoffs of a
- *         call and a put.
+ * @return Payoff for a straddle; the sum of the payoffs of a call and a put.
  */
-inline Function1 straddlePayoff(Real K) {
-	return [K] (Real S) { return S < K ? K - S : S - K; };
+inline BatchFunction1 straddlePayoff(Real K) {
+	return BatchFunction1::elementwise(
+			[K] (Real S) { return std::abs(S - K); } );
 }
 
 } // Modules
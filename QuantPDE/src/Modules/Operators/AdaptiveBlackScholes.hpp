@@ -0,0 +1,153 @@
+#ifndef QUANT_PDE_MODULES_ADAPTIVE_BLACK_SCHOLES_HPP
+#define QUANT_PDE_MODULES_ADAPTIVE_BLACK_SCHOLES_HPP
+
+#include <utility> // std::forward
+#include <vector>  // std::vector
+
+namespace QuantPDE {
+
+namespace Modules {
+
+/**
+ * The operator of BlackScholes (without jumps) discretized on an adaptive grid.
+ *
+ * At each node, the neighbours along the asset axis are taken from
+ * AdaptiveGrid::neighbour; at hanging nodes, these are interpolants of the
+ * nodes on the face of a larger leaf. The same choice between central and
+ * upwind differencing as in BlackScholes is made, so that the weights of the
+ * neighbours (and hence the off-diagonal entries) are nonpositive.
+ *
+ * @tparam SIndex The index of the risky asset.
+ * @see QuantPDE::Modules::BlackScholes
+ * @see QuantPDE::AdaptiveGrid
+**/
+template <Index Dimension, Index SIndex>
+class AdaptiveBlackScholes : public ControlledLinearSystem<Dimension> {
+
+	static_assert(Dimension > 0, "Dimension must be positive");
+	static_assert(SIndex >=0 && SIndex < Dimension,
+			"The asset index must be between 0 (inclusive) and "
+			"Dimension (exclusive)");
+
+	Controllable<Dimension> r, v, q;
+
+	const AdaptiveGrid<Dimension> &G;
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param grid The underlying spatial grid.
+	 * @param interest The risk-free interest rate.
+	 * @param volatility The volatility of the underlying asset.
+	 * @param dividends The continuous dividend rate.
+	 */
+	template <typename G1, typename F1, typename F2, typename F3>
+	AdaptiveBlackScholes(
+		G1 &grid,
+		F1 &&interest,
+		F2 &&volatility,
+		F3 &&dividends
+	) noexcept :
+		r( std::forward<F1>(interest) ),
+		v( std::forward<F2>(volatility) ),
+		q( std::forward<F3>(dividends) ),
+		G( grid )
+	{
+		this->registerControl(r);
+		this->registerControl(v);
+		this->registerControl(q);
+	}
+
+	virtual Matrix A(Real t) {
+		// Take the images of curried coefficient functions
+		auto rvec = G.image( curry<Dimension+1>(r, t) );
+		auto vvec = G.image( curry<Dimension+1>(v, t) );
+		auto qvec = G.image( curry<Dimension+1>(q, t) );
+
+		// At least 3 nonzeros per row
+		std::vector<Entry> entries;
+		entries.reserve(3 * G.size());
+
+		for(Index idx = 0; idx < G.size(); ++idx) {
+			const auto back = G.neighbour(idx, SIndex, false);
+			const auto forward = G.neighbour(idx, SIndex, true);
+
+			if(back.size == 0) {
+				// Left boundary
+				entries.emplace_back(idx, idx, rvec[idx]);
+				continue;
+			}
+
+			if(forward.size == 0) {
+				// Right boundary
+				entries.emplace_back(idx, idx, qvec[idx]);
+				continue;
+			}
+
+			// Interior point
+			const Real S_i = G.coordinates(idx)[SIndex];
+			const Real r_i = rvec[idx];
+			const Real v_i = vvec[idx];
+			const Real q_i = qvec[idx];
+
+			const Real
+				dSb = back.distance,
+				dSf = forward.distance,
+				dSc = dSb + dSf
+			;
+
+			const Real tmp1 = v_i * v_i * S_i * S_i;
+			const Real tmp2 = (r_i - q_i) * S_i;
+
+			const Real alpha_common = tmp1 / dSb / dSc;
+			const Real  beta_common = tmp1 / dSf / dSc;
+
+			// Central
+			Real alpha_i = alpha_common - tmp2 / dSc;
+			Real beta_i  =  beta_common + tmp2 / dSc;
+			if(alpha_i < 0.) {
+				// Forward
+				alpha_i = alpha_common;
+				beta_i  =  beta_common + tmp2 / dSf;
+			} else if(beta_i < 0.) {
+				// Backward
+				alpha_i = alpha_common - tmp2 / dSb;
+				beta_i  =  beta_common;
+			}
+
+			for(Index k = 0; k < back.size; ++k) {
+				entries.emplace_back(idx, back.nodes[k],
+						-alpha_i * back.weights[k]);
+			}
+			entries.emplace_back(idx, idx, alpha_i + beta_i + r_i);
+			for(Index k = 0; k < forward.size; ++k) {
+				entries.emplace_back(idx, forward.nodes[k],
+						-beta_i * forward.weights[k]);
+			}
+		}
+
+		Matrix M(G.size(), G.size());
+		M.setFromTriplets(entries.begin(), entries.end());
+		M.makeCompressed();
+		return M;
+	}
+
+	virtual Vector b(Real) {
+		return G.zero();
+	}
+
+	virtual bool isATheSame() const {
+		return r.isConstantInTime() && v.isConstantInTime()
+				&& q.isConstantInTime();
+	}
+
+};
+
+typedef AdaptiveBlackScholes<1, 0> AdaptiveBlackScholes1;
+
+} // Modules
+
+} // QuantPDE
+
+#endif
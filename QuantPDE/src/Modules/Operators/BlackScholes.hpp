@@ -36,9 +36,49 @@ class BlackScholes : public ControlledLinearSystem<Dimension> {
 
 	Controllable<Dimension> r, v, q;
 	Real kappa;
+	bool fourthOrder;
 
 	void (BlackScholes::*_computeKappa)(Real);
 
+	// Weights of the first and second derivatives at S[i] using the ticks
+	// S[i - 2], ..., S[i + 2] @cite fornberg1988generation
+	static void weights(const Axis &S, Index i, Real (&w1)[5],
+			Real (&w2)[5]) {
+		Real c[5][3] = {};
+		c[0][0] = 1.;
+
+		const Real z = S[i];
+		Real c1 = 1., c4 = S[i - 2] - z;
+		for(Index p = 1; p < 5; ++p) {
+			const Index mn = p < 2 ? p : 2;
+			Real c2 = 1.;
+			const Real c5 = c4;
+			c4 = S[i - 2 + p] - z;
+			for(Index j = 0; j < p; ++j) {
+				const Real c3 = S[i - 2 + p] - S[i - 2 + j];
+				c2 *= c3;
+				if(j == p - 1) {
+					for(Index k = mn; k > 0; --k) {
+						c[p][k] = c1 * (k * c[p - 1][k - 1]
+							- c5 * c[p - 1][k]) / c2;
+					}
+					c[p][0] = -c1 * c5 * c[p - 1][0] / c2;
+				}
+				for(Index k = mn; k > 0; --k) {
+					c[j][k] = (c4 * c[j][k] - k * c[j][k - 1])
+							/ c3;
+				}
+				c[j][0] = c4 * c[j][0] / c3;
+			}
+			c1 = c2;
+		}
+
+		for(Index j = 0; j < 5; ++j) {
+			w1[j] = c[j][1];
+			w2[j] = c[j][2];
+		}
+	}
+
 protected:
 
 	const RectilinearGrid<Dimension> &G;
@@ -84,6 +124,7 @@ protected:
 		r( std::forward<F1>(interest) ),
 		v( std::forward<F2>(volatility) ),
 		q( std::forward<F3>(dividends) ),
+		fourthOrder( false ),
 		G( grid ),
 		l( std::forward<F4>(meanArrivalTime) ),
 		g( std::forward<F5>(jumpAmplitudeDensity) )
@@ -122,6 +163,7 @@ public:
 		v( std::forward<F2>(volatility) ),
 		q( std::forward<F3>(dividends) ),
 		kappa( 0. ),
+		fourthOrder( false ),
 		G( grid ),
 		l( 0. ),
 		g( 0. )
@@ -133,11 +175,32 @@ public:
 		_computeKappa = &BlackScholes::pass;
 	}
 
-	virtual Matrix A(Real t) {
-		// 3 nonzeros per row
-		Matrix M(G.size(), G.size());
-		M.reserve( IntegerVector::Constant(G.size(), 3) );
+	/**
+	 * Selects the discretization of the derivatives in the asset. By
+	 * default, three-point central differences are used (second order).
+	 * Otherwise, five-point differences are used (fourth order on uniform
+	 * and smoothly varying grids) wherever the three-point central scheme
+	 * has positive coefficients, falling back to the three-point scheme
+	 * (with upwinding, if necessary) at the remaining nodes and next to the
+	 * boundaries. The five-point scheme is not monotone. Its order is only
+	 * attained with a higher-order timestepping method (e.g. BDFFour), a
+	 * smooth (or smoothed) initial condition, and at the nodes of the grid
+	 * (the solution is interpolated linearly between nodes).
+	 * @param enable True for the five-point discretization.
+	 */
+	void useFourthOrder(bool enable = true) {
+		fourthOrder = enable;
+	}
 
+	/**
+	 * Computes the left-hand-side matrix in DIA format (whose diagonals are
+	 * the offsets of the neighbours of a node along the asset axis).
+	 * Subclasses that change the matrix should override this (rather than
+	 * A and Ax, which use it).
+	 * @param t The time.
+	 * @return The matrix.
+	 */
+	virtual StencilMatrix stencil(Real t) {
 		// S axis
 		const Axis &S = G[SIndex];
 		const Index n = S.size();
@@ -164,6 +227,12 @@ public:
 			offset *= G[d].size();
 		}
 
+		// 3 (or 5) diagonals
+		StencilMatrix M = fourthOrder
+			? StencilMatrix(G.size(), {-2 * offset, -offset, 0,
+					offset, 2 * offset})
+			: StencilMatrix(G.size(), {-offset, 0, offset});
+
 		// Iterate through nodes on the grid
 		for(Index idx = 0; idx < G.size(); ++idx) {
 			// Retrieve index of S tick
@@ -200,6 +269,22 @@ public:
 				// Central
 				Real alpha_i = alpha_common - tmp2 / dSc;
 				Real beta_i  =  beta_common + tmp2 / dSc;
+
+				if(fourthOrder && i >= 2 && i <= n - 3
+						&& alpha_i >= 0. && beta_i >= 0.) {
+					// Five-point
+					Real w1[5], w2[5];
+					weights(S, i, w1, w2);
+
+					for(Index j = 0; j < 5; ++j) {
+						M.insert(idx, idx + (j - 2) * offset)
+							= -tmp1 / 2. * w2[j]
+							- tmp2 * w1[j]
+							+ (j == 2 ? r_i + l_i : 0.);
+					}
+					continue;
+				}
+
 				if(alpha_i < 0.) {
 					// Forward
 					alpha_i = alpha_common;
@@ -221,10 +306,17 @@ public:
 			}
 		}
 
-		M.makeCompressed();
 		return M;
 	}
 
+	virtual Matrix A(Real t) {
+		return stencil(t).matrix();
+	}
+
+	virtual Vector Ax(Real t, const Vector &x) {
+		return multiply(stencil(t), x);
+	}
+
 	virtual Vector b(Real) {
 		return G.zero();
 	}
@@ -287,7 +379,7 @@ class BlackScholesJumpDiffusion final : public IterationNode,
 		assert(S[0] >= 0.); // Can we take its log?
 
 		// Min:Step:Max
-		const int i0 = S[0] < epsilon ? 1 : 0;
+		const Index i0 = S[0] < epsilon ? 1 : 0;
 		x0 = std::log( S[i0] );
 		const Real xf = std::log( S[n-2] );
 		dx = (xf - x0) / (N - 1);
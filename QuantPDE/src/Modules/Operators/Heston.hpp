@@ -0,0 +1,326 @@
+#ifndef QUANT_PDE_MODULES_HESTON_HPP
+#define QUANT_PDE_MODULES_HESTON_HPP
+
+#include <cassert> // assert
+#include <utility> // std::forward
+#include <vector>  // std::vector
+
+namespace QuantPDE {
+
+namespace Modules {
+
+/**
+ * Represents the (discretized) operator \f$\mathcal{L}\f$ of the Heston
+ * stochastic volatility model, defined by
+ * \f[
+ *     \mathcal{L} V \equiv
+ *     - \frac{1}{2} v S^2 V_{SS} - \rho \sigma v S V_{Sv}
+ *     - \frac{1}{2} \sigma^2 v V_{vv}
+ *     - \left( r - q \right) S V_S - \kappa \left( \theta - v \right) V_v
+ *     + r V
+ * \f]
+ * where \f$v\f$ is the variance of the asset, \f$\kappa\f$ is the rate of
+ * mean reversion, \f$\theta\f$ is the long-run variance, \f$\sigma\f$ is the
+ * volatility of the variance, and \f$\rho\f$ is the correlation between the
+ * asset and its variance. The first and second axes of the grid are the asset
+ * and the variance.
+ *
+ * The boundary conditions in the asset are those of BlackScholes. At
+ * \f$v = 0\f$, the diffusion vanishes and the drift
+ * \f$\kappa\theta\f$ points into the domain, so that the equation itself
+ * (discretized with a forward difference) is imposed; no boundary data is
+ * required whether or not the Feller condition
+ * \f$2\kappa\theta\geq\sigma^2\f$ holds (if it does not, the variance reaches
+ * zero but is instantaneously reflected). At the largest variance, the
+ * diffusion in the variance is dropped and the drift is backward-differenced
+ * (or dropped, if it points out of the domain).
+ *
+ * The first derivatives are central-differenced where this yields a positive
+ * coefficient scheme and upwinded otherwise, and the mixed derivative is
+ * central-differenced. The sparsity pattern is computed on construction and
+ * the matrices are assembled in parallel.
+ *
+ * For ADI schemes, the matrix is split into three components: the mixed
+ * derivative term, the terms involving the asset, and the terms involving
+ * the variance (with the discounting term shared equally by the latter two).
+ *
+ * @see QuantPDE::DouglasADI
+ * @see QuantPDE::Modules::BlackScholes
+**/
+class Heston final : public ControlledLinearSystem2,
+		public SplitLinearSystem {
+
+	// Terms of the operator
+	enum Terms {
+		Mixed = 1,
+		Asset = 2,
+		Variance = 4,
+		All = Mixed | Asset | Variance
+	};
+
+	Controllable2 r, q;
+	const Real kappa, theta, sigma, rho;
+
+	const RectilinearGrid2 &G;
+
+	// Patterns of the matrix and its components
+	SparsityPattern all, mixed, asset, variance;
+
+	// Appends the columns of the given terms at a node
+	void columns(Index idx, int terms, std::vector<Index> &c) const {
+		const Index n = G[0].size(), m = G[1].size();
+		const Index i = idx % n, j = idx / n;
+
+		if(terms & (Asset | Variance)) {
+			c.push_back(idx);
+		}
+
+		if(i == 0 || i == n - 1) {
+			return;
+		}
+
+		if(terms & Asset) {
+			c.push_back(idx - 1);
+			c.push_back(idx + 1);
+		}
+
+		if(terms & Variance) {
+			if(j > 0) {
+				c.push_back(idx - n);
+			}
+			if(j < m - 1) {
+				c.push_back(idx + n);
+			}
+		}
+
+		if((terms & Mixed) && j > 0 && j < m - 1) {
+			c.push_back(idx - n - 1);
+			c.push_back(idx - n + 1);
+			c.push_back(idx + n - 1);
+			c.push_back(idx + n + 1);
+		}
+	}
+
+	SparsityPattern pattern(int terms) const {
+		return SparsityPattern(G.size(), [&] (Index idx,
+				std::vector<Index> &c) {
+			columns(idx, terms, c);
+		});
+	}
+
+	// Second-order term a V_xx and first-order term b V_x along an axis
+	// (central if possible, upwind otherwise)
+	static void coefficients(
+		Real a,
+		Real b,
+		Real dxb,
+		Real dxf,
+		Real &alpha,
+		Real &beta
+	) {
+		const Real dxc = dxb + dxf;
+
+		const Real alpha_common = 2. * a / dxb / dxc;
+		const Real  beta_common = 2. * a / dxf / dxc;
+
+		// Central
+		alpha = alpha_common - b / dxc;
+		beta  =  beta_common + b / dxc;
+		if(alpha < 0.) {
+			// Forward
+			alpha = alpha_common;
+			beta  =  beta_common + b / dxf;
+		} else if(beta < 0.) {
+			// Backward
+			alpha = alpha_common - b / dxb;
+			beta  =  beta_common;
+		}
+	}
+
+	Matrix assemble(Real t, int terms, const SparsityPattern &P) {
+		// Take the images of curried coefficient functions
+		const Vector rvec = G.image( curry<3>(r, t) );
+		const Vector qvec = G.image( curry<3>(q, t) );
+
+		const Axis &S = G[0], &V = G[1];
+		const Index n = S.size(), m = V.size();
+
+		return P.assemble( [&] (Index idx, SparsityPattern::Row &row) {
+			const Index i = idx % n, j = idx / n;
+
+			const Real r_i = rvec[idx];
+			const Real q_i = qvec[idx];
+
+			// The discounting term is shared by the asset and
+			// variance components
+			const Real share = ((terms & Asset) ? .5 : 0.)
+					+ ((terms & Variance) ? .5 : 0.);
+
+			if(i == 0) {
+				// Left boundary
+				if(share > 0.) {
+					row(idx) += share * r_i;
+				}
+				return;
+			}
+
+			if(i == n - 1) {
+				// Right boundary
+				if(share > 0.) {
+					row(idx) += share * q_i;
+				}
+				return;
+			}
+
+			if(share > 0.) {
+				row(idx) += share * r_i;
+			}
+
+			const Real S_i = S[i], v_j = V[j];
+
+			if(terms & Asset) {
+				Real alpha, beta;
+				coefficients(.5 * v_j * S_i * S_i,
+						(r_i - q_i) * S_i,
+						S[i] - S[i - 1], S[i + 1] - S[i],
+						alpha, beta);
+
+				row(idx - 1) -= alpha;
+				row(idx)     += alpha + beta;
+				row(idx + 1) -= beta;
+			}
+
+			if(terms & Variance) {
+				const Real drift = kappa * (theta - v_j);
+
+				Real alpha = 0., beta = 0.;
+				if(j == 0) {
+					// Degenerate equation; the drift points
+					// into the domain
+					beta = drift / (V[1] - V[0]);
+				} else if(j == m - 1) {
+					// Outflow (if the drift points out of
+					// the domain)
+					if(drift < 0.) {
+						alpha = -drift / (V[j] - V[j - 1]);
+					}
+				} else {
+					coefficients(.5 * sigma * sigma * v_j,
+							drift,
+							V[j] - V[j - 1],
+							V[j + 1] - V[j],
+							alpha, beta);
+				}
+
+				if(j > 0) {
+					row(idx - n) -= alpha;
+				}
+				row(idx) += alpha + beta;
+				if(j < m - 1) {
+					row(idx + n) -= beta;
+				}
+			}
+
+			if((terms & Mixed) && j > 0 && j < m - 1) {
+				const Real w = rho * sigma * v_j * S_i
+						/ (S[i + 1] - S[i - 1])
+						/ (V[j + 1] - V[j - 1]);
+
+				row(idx + n + 1) -= w;
+				row(idx - n - 1) -= w;
+				row(idx + n - 1) += w;
+				row(idx - n + 1) += w;
+			}
+		} );
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param grid The underlying spatial grid (asset by variance).
+	 * @param interest The risk-free interest rate.
+	 * @param dividends The continuous dividend rate.
+	 * @param meanReversion The rate of mean reversion of the variance.
+	 * @param longRunVariance The long-run variance.
+	 * @param volatilityOfVariance The volatility of the variance.
+	 * @param correlation The correlation between the asset and its
+	 *                    variance.
+	 */
+	template <typename G1, typename F1, typename F2>
+	Heston(
+		G1 &grid,
+		F1 &&interest,
+		F2 &&dividends,
+		Real meanReversion,
+		Real longRunVariance,
+		Real volatilityOfVariance,
+		Real correlation
+	) :
+		r( std::forward<F1>(interest) ),
+		q( std::forward<F2>(dividends) ),
+		kappa( meanReversion ),
+		theta( longRunVariance ),
+		sigma( volatilityOfVariance ),
+		rho( correlation ),
+		G( grid ),
+		all( pattern(All) ),
+		mixed( pattern(Mixed) ),
+		asset( pattern(Asset) ),
+		variance( pattern(Variance) )
+	{
+		assert(kappa >= 0.);
+		assert(theta >= 0.);
+		assert(sigma >= 0.);
+		assert(rho >= -1. && rho <= 1.);
+		assert(G[0].size() >= 3 && G[1].size() >= 2);
+		assert(G[1][0] >= 0.);
+
+		this->registerControl(r);
+		this->registerControl(q);
+	}
+
+	/**
+	 * @return True if and only if the Feller condition
+	 *         \f$2\kappa\theta\geq\sigma^2\f$ holds (i.e. the variance
+	 *         never reaches zero).
+	 */
+	bool isFellerConditionSatisfied() const {
+		return 2. * kappa * theta >= sigma * sigma;
+	}
+
+	virtual Matrix A(Real t) {
+		return assemble(t, All, all);
+	}
+
+	virtual Vector b(Real) {
+		return G.zero();
+	}
+
+	virtual bool isATheSame() const {
+		return r.isConstantInTime() && q.isConstantInTime();
+	}
+
+	virtual Index components() const {
+		return 3;
+	}
+
+	virtual Matrix component(Real t, Index k) {
+		switch(k) {
+			case 0:
+				return assemble(t, Mixed, mixed);
+			case 1:
+				return assemble(t, Asset, asset);
+			default:
+				assert(k == 2);
+				return assemble(t, Variance, variance);
+		}
+	}
+
+};
+
+} // Modules
+
+} // QuantPDE
+
+#endif
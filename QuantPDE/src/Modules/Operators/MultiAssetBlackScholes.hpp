@@ -0,0 +1,299 @@
+#ifndef QUANT_PDE_MODULES_MULTI_ASSET_BLACK_SCHOLES_HPP
+#define QUANT_PDE_MODULES_MULTI_ASSET_BLACK_SCHOLES_HPP
+
+#include <array>   // std::array
+#include <cassert> // assert
+#include <cmath>   // std::abs
+#include <utility> // std::forward
+#include <vector>  // std::vector
+
+namespace QuantPDE {
+
+namespace Modules {
+
+/**
+ * Represents the (discretized) operator \f$\mathcal{L}\f$ of a basket of
+ * correlated assets, defined by
+ * \f[
+ *     \mathcal{L} V \equiv
+ *     - \frac{1}{2} \sum_{a, b} \rho_{ab} \sigma_a \sigma_b S_a S_b
+ *     V_{S_a S_b}
+ *     - \sum_a \left( r - q_a \right) S_a V_{S_a} + r V
+ * \f]
+ * where the \f$a\f$-th axis of the grid is the \f$a\f$-th asset.
+ *
+ * The boundary conditions are those of BlackScholes, applied along each axis
+ * separately: at \f$S_a = 0\f$, the terms involving the \f$a\f$-th asset
+ * vanish, while at the largest value of \f$S_a\f$, the option is assumed to
+ * be linear in that asset (\f$S_a V_{S_a} = V\f$) and the terms involving its
+ * second derivatives are dropped.
+ *
+ * The mixed derivatives are discretized with the seven-point stencil whose
+ * corners lie along the direction of correlation (i.e. \f$(+, +)\f$ and
+ * \f$(-, -)\f$ for positive correlations and \f$(+, -)\f$ and \f$(-, +)\f$
+ * for negative ones), so that the corner coefficients are nonpositive. Each
+ * neighbour along the \f$a\f$-th axis loses the mixed derivative contributions
+ * of every other axis, so the remaining coefficients are nonpositive (and the
+ * scheme is monotone) as long as the grid is not too stretched relative to the
+ * volatilities; for example, it suffices that
+ * \f$\sigma_a S_a / \Delta S_a
+ * \geq \sum_{b \neq a} \left|\rho_{ab}\right| \sigma_b S_b / \Delta S_b\f$
+ * for each asset \f$a\f$. In two dimensions, this holds for any correlation if
+ * the spacing of each axis is proportional to \f$\sigma_a S_a\f$. The sparsity
+ * pattern is computed on construction and the matrices are assembled in
+ * parallel.
+ *
+ * For ADI schemes, the matrix is split into the mixed derivative terms and the
+ * terms involving each of the assets (with the discounting term shared
+ * equally by the latter).
+ *
+ * @see QuantPDE::DouglasADI
+ * @see QuantPDE::Modules::BlackScholes
+**/
+template <Index Dimension>
+class MultiAssetBlackScholes final : public ControlledLinearSystem<Dimension>,
+		public SplitLinearSystem {
+
+	static_assert(Dimension > 1, "Dimension must be at least two");
+
+	// Selects all components
+	static constexpr Index All = -1;
+
+	Controllable<Dimension> r;
+	std::array<Real, Dimension> v, q;
+	std::array<std::array<Real, Dimension>, Dimension> rho;
+
+	const RectilinearGrid<Dimension> &G;
+	std::array<Index, Dimension> strides;
+
+	// Pattern of the matrix followed by those of its components
+	std::vector<SparsityPattern> patterns;
+
+	// Second-order term a V_xx and first-order term b V_x along an axis
+	// (central if possible, upwind otherwise)
+	static void coefficients(
+		Real a,
+		Real b,
+		Real dxb,
+		Real dxf,
+		Real &alpha,
+		Real &beta
+	) {
+		const Real dxc = dxb + dxf;
+
+		const Real alpha_common = 2. * a / dxb / dxc;
+		const Real  beta_common = 2. * a / dxf / dxc;
+
+		// Central
+		alpha = alpha_common - b / dxc;
+		beta  =  beta_common + b / dxc;
+		if(alpha < 0.) {
+			// Forward
+			alpha = alpha_common;
+			beta  =  beta_common + b / dxf;
+		} else if(beta < 0.) {
+			// Backward
+			alpha = alpha_common - b / dxb;
+			beta  =  beta_common;
+		}
+	}
+
+	// Calls add(column, value) for each entry of the given component (or of
+	// the whole matrix) in the row of a node; the columns do not depend on
+	// the interest rate
+	template <typename F>
+	void stencil(Index idx, Index k, Real r_i, F &&add) const {
+		std::array<Index, Dimension> i;
+		for(Index d = 0; d < Dimension; ++d) {
+			i[d] = (idx / strides[d]) % G[d].size();
+		}
+
+		for(Index d = 0; d < Dimension; ++d) {
+			if(k != All && k != d + 1) {
+				continue;
+			}
+
+			add(idx, r_i / Dimension);
+
+			const Axis &S = G[d];
+			if(i[d] == 0) {
+				// Left boundary
+				continue;
+			}
+			if(i[d] == S.size() - 1) {
+				// Right boundary (linearity assumption)
+				add(idx, q[d] - r_i);
+				continue;
+			}
+
+			// Interior point
+			const Index j = i[d];
+			Real alpha, beta;
+			coefficients(.5 * v[d] * v[d] * S[j] * S[j],
+					(r_i - q[d]) * S[j],
+					S[j] - S[j - 1], S[j + 1] - S[j],
+					alpha, beta);
+
+			add(idx - strides[d], -alpha);
+			add(idx, alpha + beta);
+			add(idx + strides[d], -beta);
+		}
+
+		if(k != All && k != 0) {
+			return;
+		}
+
+		for(Index a = 0; a < Dimension; ++a) {
+			if(i[a] == 0 || i[a] == G[a].size() - 1) {
+				continue;
+			}
+
+			for(Index b = a + 1; b < Dimension; ++b) {
+				if(i[b] == 0 || i[b] == G[b].size() - 1
+						|| rho[a][b] == 0.) {
+					continue;
+				}
+
+				const Axis &Sa = G[a], &Sb = G[b];
+				const Index ia = i[a], ib = i[b];
+				const Index sa = strides[a], sb = strides[b];
+
+				const Real
+					dab = Sa[ia] - Sa[ia - 1],
+					daf = Sa[ia + 1] - Sa[ia],
+					dbb = Sb[ib] - Sb[ib - 1],
+					dbf = Sb[ib + 1] - Sb[ib]
+				;
+
+				const Real c = std::abs(rho[a][b]) * v[a] * v[b]
+						* Sa[ia] * Sb[ib];
+
+				if(rho[a][b] > 0.) {
+					// (+, +) and (-, -) corners
+					const Real wf = c / (2. * daf * dbf);
+					const Real wb = c / (2. * dab * dbb);
+
+					add(idx + sa + sb, -wf);
+					add(idx + sa, wf);
+					add(idx + sb, wf);
+					add(idx - sa - sb, -wb);
+					add(idx - sa, wb);
+					add(idx - sb, wb);
+					add(idx, -wf - wb);
+				} else {
+					// (+, -) and (-, +) corners
+					const Real w1 = c / (2. * daf * dbb);
+					const Real w2 = c / (2. * dab * dbf);
+
+					add(idx + sa - sb, -w1);
+					add(idx + sa, w1);
+					add(idx - sb, w1);
+					add(idx - sa + sb, -w2);
+					add(idx - sa, w2);
+					add(idx + sb, w2);
+					add(idx, -w1 - w2);
+				}
+			}
+		}
+	}
+
+	SparsityPattern pattern(Index k) const {
+		return SparsityPattern(G.size(), [&] (Index idx,
+				std::vector<Index> &c) {
+			stencil(idx, k, 0., [&] (Index j, Real) {
+				c.push_back(j);
+			});
+		});
+	}
+
+	Matrix assemble(Real t, Index k) {
+		// Take the image of the curried interest rate
+		const Vector rvec = G.image( curry<Dimension+1>(r, t) );
+
+		return patterns[k + 1].assemble( [&] (Index idx,
+				SparsityPattern::Row &row) {
+			stencil(idx, k, rvec[idx], [&] (Index j, Real w) {
+				row(j) += w;
+			});
+		} );
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param grid The underlying spatial grid (one axis per asset).
+	 * @param interest The risk-free interest rate.
+	 * @param volatilities The volatilities of the assets.
+	 * @param dividends The continuous dividend rates of the assets.
+	 * @param correlation The (symmetric) correlation matrix.
+	 */
+	template <typename G1, typename F1>
+	MultiAssetBlackScholes(
+		G1 &grid,
+		F1 &&interest,
+		const std::array<Real, Dimension> &volatilities,
+		const std::array<Real, Dimension> &dividends,
+		const Real (&correlation)[Dimension][Dimension]
+	) :
+		r( std::forward<F1>(interest) ),
+		v( volatilities ),
+		q( dividends ),
+		G( grid )
+	{
+		for(Index a = 0; a < Dimension; ++a) {
+			assert(v[a] >= 0.);
+			assert(G[a].size() >= 3);
+			assert(G[a][0] >= 0.);
+			for(Index b = 0; b < Dimension; ++b) {
+				assert(correlation[a][b] == correlation[b][a]);
+				assert(correlation[a][b] >= -1.
+						&& correlation[a][b] <= 1.);
+				rho[a][b] = correlation[a][b];
+			}
+		}
+
+		strides[0] = 1;
+		for(Index d = 1; d < Dimension; ++d) {
+			strides[d] = strides[d - 1] * G[d - 1].size();
+		}
+
+		patterns.reserve(Dimension + 2);
+		for(Index k = All; k <= Dimension; ++k) {
+			patterns.push_back( pattern(k) );
+		}
+
+		this->registerControl(r);
+	}
+
+	virtual Matrix A(Real t) {
+		return assemble(t, All);
+	}
+
+	virtual Vector b(Real) {
+		return G.zero();
+	}
+
+	virtual bool isATheSame() const {
+		return r.isConstantInTime();
+	}
+
+	virtual Index components() const {
+		return Dimension + 1;
+	}
+
+	virtual Matrix component(Real t, Index k) {
+		assert(k >= 0 && k <= Dimension);
+		return assemble(t, k);
+	}
+
+};
+
+typedef MultiAssetBlackScholes<2> MultiAssetBlackScholes2;
+typedef MultiAssetBlackScholes<3> MultiAssetBlackScholes3;
+
+} // Modules
+
+} // QuantPDE
+
+#endif
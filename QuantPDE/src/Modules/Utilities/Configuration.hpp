@@ -15,7 +15,7 @@ namespace QuantPDE {
 typedef Json::Value Configuration;
 
 #define QUANT_PDE_CONFIGURATION_GET(name, type, asType) \
-	type name( \
+	inline type name( \
 		Configuration &configuration, \
 		const std::string &key, \
 		type defaultValue \
@@ -33,7 +33,7 @@ QUANT_PDE_CONFIGURATION_GET(getString, std::string, asString)
 
 #undef QUANT_PDE_CONFIGURATION_GET
 
-Configuration getConfiguration(int argc, char **argv) {
+inline Configuration getConfiguration(int argc, char **argv) {
 
 	bool input = false;
 
@@ -96,7 +96,8 @@ public:
 					j < defaultValue[i].size();
 					++j
 				) {
-					configuration[key][i][j]
+					configuration[key][(Json::ArrayIndex) i]
+							[(Json::ArrayIndex) j]
 							= defaultValue[i][j];
 				}
 			}
@@ -105,10 +106,12 @@ public:
 
 		Axis axes[Dimension];
 		for(Index i = 0; i < Dimension; ++i) {
-			axes[i].length = configuration[key][i].size();
+			const Json::Value &axis =
+					configuration[key][(Json::ArrayIndex) i];
+			axes[i].length = axis.size();
 			axes[i].n = new Real[axes[i].length];
 			for(Index j = 0; j < axes[i].length; ++j) {
-				axes[i].n[j] = (Real) configuration[key][i][j]
+				axes[i].n[j] = (Real) axis[(Json::ArrayIndex) j]
 						.asDouble();
 			}
 		}
@@ -0,0 +1,359 @@
+#ifndef QUANT_PDE_MODULES_LINEAR_SYSTEM_CAPTURE_HPP
+#define QUANT_PDE_MODULES_LINEAR_SYSTEM_CAPTURE_HPP
+
+#include <cerrno>     // errno, EEXIST
+#include <chrono>     // std::chrono
+#include <cstdio>     // std::snprintf
+#include <fstream>    // std::ifstream, std::ofstream
+#include <iomanip>    // std::setprecision
+#include <limits>     // std::numeric_limits
+#include <sstream>    // std::istringstream
+#include <string>     // std::string, std::getline
+#include <vector>     // std::vector
+
+// Capturing (which creates a directory) is only available on POSIX platforms
+#if defined(__unix__) || defined(__APPLE__)
+#define QUANT_PDE_LINEAR_SYSTEM_CAPTURE
+#include <sys/stat.h> // mkdir
+#endif
+
+namespace QuantPDE {
+
+/**
+ * Writes a sparse matrix in the Matrix Market coordinate format.
+ * @param path The file to write to.
+ * @param A The matrix.
+ */
+inline void writeMatrixMarket(const std::string &path, const Matrix &A) {
+	std::ofstream out(path);
+	if(!out) {
+		throw "error: could not open Matrix Market file";
+	}
+
+	out << "%%MatrixMarket matrix coordinate real general\n";
+	out << A.rows() << ' ' << A.cols() << ' ' << A.nonZeros() << '\n';
+	out << std::setprecision(std::numeric_limits<Real>::max_digits10);
+	for(Index i = 0; i < A.outerSize(); ++i) {
+		for(Matrix::InnerIterator it(A, i); it; ++it) {
+			out << it.row() + 1 << ' ' << it.col() + 1 << ' '
+					<< it.value() << '\n';
+		}
+	}
+}
+
+/**
+ * Writes a vector in the Matrix Market array format.
+ * @param path The file to write to.
+ * @param v The vector.
+ */
+inline void writeMatrixMarket(const std::string &path, const Vector &v) {
+	std::ofstream out(path);
+	if(!out) {
+		throw "error: could not open Matrix Market file";
+	}
+
+	out << "%%MatrixMarket matrix array real general\n";
+	out << v.size() << " 1\n";
+	out << std::setprecision(std::numeric_limits<Real>::max_digits10);
+	for(Index i = 0; i < v.size(); ++i) {
+		out << v(i) << '\n';
+	}
+}
+
+/**
+ * Skips the header and comments of a Matrix Market file.
+ */
+inline std::ifstream openMatrixMarket(const std::string &path) {
+	std::ifstream in(path);
+	if(!in) {
+		throw "error: could not open Matrix Market file";
+	}
+	while(in.peek() == '%') {
+		in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+	}
+	return in;
+}
+
+/**
+ * Reads a sparse matrix in the Matrix Market coordinate format.
+ * @param path The file to read from.
+ * @return The matrix.
+ */
+inline Matrix readMatrixMarketMatrix(const std::string &path) {
+	std::ifstream in = openMatrixMarket(path);
+
+	Index rows, cols, nonzeros;
+	in >> rows >> cols >> nonzeros;
+
+	std::vector<Entry> entries;
+	entries.reserve(nonzeros);
+	for(Index k = 0; k < nonzeros; ++k) {
+		Index i, j;
+		Real value;
+		in >> i >> j >> value;
+		entries.emplace_back(i - 1, j - 1, value);
+	}
+
+	Matrix A(rows, cols);
+	A.setFromTriplets(entries.begin(), entries.end());
+	A.makeCompressed();
+	return A;
+}
+
+/**
+ * Reads a vector in the Matrix Market array format.
+ * @param path The file to read from.
+ * @return The vector.
+ */
+inline Vector readMatrixMarketVector(const std::string &path) {
+	std::ifstream in = openMatrixMarket(path);
+
+	Index rows, cols;
+	in >> rows >> cols;
+	assert(cols == 1);
+
+	Vector v(rows);
+	for(Index i = 0; i < rows; ++i) {
+		in >> v(i);
+	}
+	return v;
+}
+
+/**
+ * A linear solver that forwards to another solver and writes the linear
+ * systems it is asked to solve (along with the initial guesses and the
+ * solutions) to a directory in the Matrix Market format.
+ *
+ * The directory contains a file named manifest listing, for each captured
+ * solve, the files holding \f$A\f$, \f$b\f$, the initial guess and the
+ * solution. A matrix is written at most once, and only if a solve using it is
+ * captured.
+ *
+ * Capturing is only supported on POSIX platforms; elsewhere, the constructor
+ * throws. Reading and replaying captured systems work everywhere.
+ *
+ * @see QuantPDE::replayLinearSystems
+ */
+class CapturingLinearSolver : public LinearSolver {
+
+	LinearSolver &solver;
+	const std::string directory;
+	const int stride;
+	const int limit;
+
+	std::ofstream manifest;
+
+	int matrices, solves, captured, written;
+
+	std::string path(const char *prefix, int index) const {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%s_%06d.mtx", prefix, index);
+		return name;
+	}
+
+	virtual void initialize() {
+		solver.initialize(std::move(A));
+		++matrices;
+	}
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param solver The solver to forward to.
+	 * @param directory The directory to write to (created if it does not
+	 *                  exist).
+	 * @param stride Only every stride-th solve is captured.
+	 * @param limit The maximum number of solves captured (negative for no
+	 *              limit).
+	 */
+	CapturingLinearSolver(
+		LinearSolver &solver,
+		const std::string &directory,
+		int stride = 1,
+		int limit = -1
+	) :
+		LinearSolver(),
+		solver(solver),
+		directory(directory),
+		stride(stride),
+		limit(limit),
+		matrices(0),
+		solves(0),
+		captured(0),
+		written(-1)
+	{
+		assert(stride > 0);
+
+		#ifdef QUANT_PDE_LINEAR_SYSTEM_CAPTURE
+		if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+			throw "error: could not create capture directory";
+		}
+		#else
+		throw "error: linear system capture is not supported on this "
+				"platform";
+		#endif
+
+		manifest.open(directory + "/manifest");
+		if(!manifest) {
+			throw "error: could not open capture manifest";
+		}
+	}
+
+	virtual Vector solve(const Vector &b, const Vector &guess) {
+		Vector x = solver.solve(b, guess);
+
+		// Forward iteration counts
+		const std::vector<size_t> &inner = solver.iterations();
+		while(its.size() < inner.size()) {
+			its.push_back(inner[its.size()]);
+		}
+
+		if(solves++ % stride == 0 && (limit < 0 || captured < limit)) {
+			const int m = matrices - 1;
+			if(written != m) {
+				writeMatrixMarket(directory + "/" + path("A", m),
+						solver.matrix());
+				written = m;
+			}
+
+			writeMatrixMarket(directory + "/"
+					+ path("b", captured), b);
+			writeMatrixMarket(directory + "/"
+					+ path("guess", captured), guess);
+			writeMatrixMarket(directory + "/"
+					+ path("x", captured), x);
+
+			manifest
+				<< path("A", m) << ' '
+				<< path("b", captured) << ' '
+				<< path("guess", captured) << ' '
+				<< path("x", captured) << std::endl
+			;
+
+			++captured;
+		}
+
+		return x;
+	}
+
+	/**
+	 * @return The number of bytes held by the solver forwarded to (which
+	 *         holds the matrix).
+	 */
+	virtual size_t memoryUsage() const {
+		return solver.memoryUsage();
+	}
+
+	/**
+	 * @return The number of solves captured so far.
+	 */
+	int capturedSolves() const {
+		return captured;
+	}
+
+};
+
+/**
+ * Statistics of a single replayed solve.
+ */
+struct ReplayedSolve {
+
+	/**
+	 * Time spent initializing the solver (zero if the matrix did not
+	 * change since the previous solve).
+	 */
+	Real initialization_seconds;
+
+	/**
+	 * Time spent solving.
+	 */
+	Real solve_seconds;
+
+	/**
+	 * Iterations reported by the solver (zero for direct solvers).
+	 */
+	size_t iterations;
+
+	/**
+	 * \f$\left\Vert b - Ax \right\Vert / \left\Vert b \right\Vert\f$.
+	 */
+	Real residual;
+
+	/**
+	 * Relative error with respect to the captured solution.
+	 * @see QuantPDE::relativeError
+	 */
+	Real error;
+
+};
+
+/**
+ * Solves, in order, the linear systems captured by a CapturingLinearSolver.
+ * @param directory The directory written to by a CapturingLinearSolver.
+ * @param solver The solver to benchmark.
+ * @return Statistics for each solve.
+ * @see QuantPDE::CapturingLinearSolver
+ */
+inline std::vector<ReplayedSolve> replayLinearSystems(
+	const std::string &directory,
+	LinearSolver &solver
+) {
+	std::ifstream manifest(directory + "/manifest");
+	if(!manifest) {
+		throw "error: could not open capture manifest";
+	}
+
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<ReplayedSolve> solves;
+	std::string line, current;
+	while(std::getline(manifest, line)) {
+		std::istringstream files(line);
+		std::string a, b, guess, x;
+		if(!(files >> a >> b >> guess >> x)) {
+			continue;
+		}
+
+		ReplayedSolve solve;
+
+		solve.initialization_seconds = 0.;
+		if(a != current) {
+			Matrix A = readMatrixMarketMatrix(directory + "/" + a);
+			auto start = Clock::now();
+			solver.initialize(std::move(A));
+			solve.initialization_seconds =
+				std::chrono::duration<Real>(Clock::now() - start)
+				.count();
+			current = a;
+		}
+
+		const Vector rhs = readMatrixMarketVector(directory + "/" + b);
+		const Vector x0 = readMatrixMarketVector(
+				directory + "/" + guess);
+		const Vector reference = readMatrixMarketVector(
+				directory + "/" + x);
+
+		const size_t before = solver.iterations().size();
+		auto start = Clock::now();
+		const Vector solution = solver.solve(rhs, x0);
+		solve.solve_seconds = std::chrono::duration<Real>(Clock::now()
+				- start).count();
+
+		const std::vector<size_t> &its = solver.iterations();
+		solve.iterations = its.size() > before ? its.back() : 0;
+
+		const Real norm = rhs.norm();
+		solve.residual = (rhs - solver.matrix() * solution).norm()
+				/ (norm > 0. ? norm : 1.);
+		solve.error = relativeError(solution, reference);
+
+		solves.push_back(solve);
+	}
+
+	return solves;
+}
+
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef QUANT_PDE_MODULES_SNAPSHOT_WRITER_HPP
+#define QUANT_PDE_MODULES_SNAPSHOT_WRITER_HPP
+
+#include <algorithm>  // std::copy
+#include <cassert>    // assert
+#include <cstdlib>    // size_t
+#include <string>     // std::string
+
+// Memory mapping is only available on POSIX platforms
+#if defined(__unix__) || defined(__APPLE__)
+#define QUANT_PDE_MAPPED_SNAPSHOTS
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, msync, munmap
+#include <unistd.h>   // close, ftruncate, sysconf
+#endif
+
+namespace QuantPDE {
+
+/**
+ * Stores snapshots in a buffer whose size is fixed on construction: either
+ * anonymous memory or a memory-mapped file. Each snapshot is written straight
+ * from the iterand into the buffer (split into blocks written in parallel, as
+ * in QuantPDE::fill); for files, the pages of the snapshot are then scheduled
+ * to be written back by the operating system (msync with MS_ASYNC) so that the
+ * time loop never waits for the disk.
+ *
+ * On platforms other than POSIX ones, only the in-memory buffer (allocated
+ * on the heap) is supported.
+ *
+ * The k-th snapshot occupies nodes + 1 consecutive reals starting at the
+ * (k * (nodes + 1))-th real of the buffer (file): its time followed by its
+ * values.
+ * \code{.cpp}
+ * MappedSnapshotWriter snapshots(grid.size(), dates.size(), "exposure.bin");
+ * for(Real t : dates) {
+ * 	stepper.snapshot(t, snapshots);
+ * }
+ * auto V = stepper.solve(grid, payoff, discretization, solver);
+ * Real t0 = snapshots.time(0);
+ * auto V0 = snapshots[0]; // Values at time t0 (not a copy)
+ * \endcode
+ */
+class MappedSnapshotWriter final : public SnapshotSink {
+
+	const size_t n, capacity_;
+	size_t count;
+
+	int fd;
+	Real *buffer;
+	size_t length; // In bytes
+
+public:
+
+	/**
+	 * Constructor.
+	 * @param nodes The number of domain nodes.
+	 * @param capacity The maximum number of snapshots.
+	 * @param path If nonempty, snapshots are written to this file (which is
+	 *             truncated); anonymous memory is used otherwise. Files are
+	 *             only supported on POSIX platforms; elsewhere, an
+	 *             exception is thrown.
+	 */
+	MappedSnapshotWriter(
+		size_t nodes,
+		size_t capacity,
+		const std::string &path = ""
+	) : n(nodes), capacity_(capacity), count(0), fd(-1), buffer(nullptr),
+			length(capacity * (nodes + 1) * sizeof(Real)) {
+		assert(capacity > 0);
+
+		#ifdef QUANT_PDE_MAPPED_SNAPSHOTS
+		void *p;
+		if(path.empty()) {
+			p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		} else {
+			fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+					0644);
+			if(fd < 0) {
+				throw "error: could not open snapshot file";
+			}
+			if(ftruncate(fd, length) != 0) {
+				close(fd);
+				throw "error: could not allocate snapshot file";
+			}
+			p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, 0);
+		}
+
+		if(p == MAP_FAILED) {
+			if(fd >= 0) {
+				close(fd);
+			}
+			throw "error: could not map snapshot buffer";
+		}
+		buffer = (Real *) p;
+		#else
+		if(!path.empty()) {
+			throw "error: snapshot files are not supported on this "
+					"platform";
+		}
+		buffer = new Real[capacity * (nodes + 1)];
+		#endif
+	}
+
+	/**
+	 * Destructor. Unmaps the buffer (the file keeps the snapshots).
+	 */
+	virtual ~MappedSnapshotWriter() {
+		#ifdef QUANT_PDE_MAPPED_SNAPSHOTS
+		munmap(buffer, length);
+		if(fd >= 0) {
+			close(fd);
+		}
+		#else
+		delete [] buffer;
+		#endif
+	}
+
+	// Disable copy constructor and assignment operator.
+	MappedSnapshotWriter(const MappedSnapshotWriter &) = delete;
+	MappedSnapshotWriter &operator=(const MappedSnapshotWriter &) = delete;
+
+	virtual void write(Real time, const Vector &solution) {
+		assert((size_t) solution.size() == n);
+		if(count == capacity_) {
+			throw "error: snapshot buffer is full";
+		}
+
+		Real *record = buffer + count * (n + 1);
+		record[0] = time;
+
+		const Real *values = solution.data();
+		const Index blocks = parallelFirstTouch() ? multiplyBlocks(n)
+				: 1;
+		parallelBlocks(blocks, [&] (Index k) {
+			const size_t first = (n * k) / blocks;
+			const size_t last  = (n * (k + 1)) / blocks;
+			std::copy(values + first, values + last,
+					record + 1 + first);
+		});
+
+		#ifdef QUANT_PDE_MAPPED_SNAPSHOTS
+		if(fd >= 0) {
+			// Start writing back the (page-aligned) record
+			const size_t page = sysconf(_SC_PAGESIZE);
+			const size_t begin = ((char *) record - (char *) buffer)
+					/ page * page;
+			const size_t end = (n + 1) * sizeof(Real)
+					+ ((char *) record - (char *) buffer);
+			msync((char *) buffer + begin, end - begin, MS_ASYNC);
+		}
+		#endif
+
+		++count;
+	}
+
+	/**
+	 * Removes all snapshots (the buffer is reused).
+	 */
+	void clear() {
+		count = 0;
+	}
+
+	/**
+	 * @return The number of snapshots.
+	 */
+	size_t size() const {
+		return count;
+	}
+
+	/**
+	 * @return The maximum number of snapshots.
+	 */
+	size_t capacity() const {
+		return capacity_;
+	}
+
+	/**
+	 * @return The number of domain nodes in each snapshot.
+	 */
+	size_t nodes() const {
+		return n;
+	}
+
+	/**
+	 * @param k The index of a snapshot (in the order they were taken).
+	 * @return The time of the snapshot.
+	 */
+	Real time(size_t k) const {
+		assert(k < count);
+		return buffer[k * (n + 1)];
+	}
+
+	/**
+	 * @param k The index of a snapshot (in the order they were taken).
+	 * @return A view of the values of the snapshot (valid as long as this
+	 *         object is).
+	 */
+	Eigen::Map<const Vector> operator[](size_t k) const {
+		assert(k < count);
+		return Eigen::Map<const Vector>(buffer + k * (n + 1) + 1, n);
+	}
+
+};
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+// replay_linear_systems.cpp
+// -------------------------
+//
+// Benchmarks a linear solver on linear systems captured by a
+// CapturingLinearSolver, reporting the time, iterations and accuracy of each
+// solve.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <QuantPDE/Core>
+#include <QuantPDE/Modules/Utilities>
+
+using namespace QuantPDE;
+
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iomanip>  // setw
+#include <iostream> // cerr, cout
+#include <memory>   // unique_ptr
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+	// Parse configuration file
+	Configuration configuration = getConfiguration(argc, argv);
+
+	// Get options
+	const string directory = getString(configuration, "directory",
+			"capture");
+	const string solver_name = getString(configuration, "solver",
+			"bicgstab");
+	const bool verbose = getBool(configuration, "print_each_solve", true);
+
+	// Print configuration file
+	cerr << configuration << endl << endl;
+
+	unique_ptr<LinearSolver> solver;
+	if(solver_name == "bicgstab") {
+		solver = unique_ptr<LinearSolver>(new BiCGSTABSolver);
+	} else if(solver_name == "sparse_lu") {
+		solver = unique_ptr<LinearSolver>(new SparseLUSolver);
+	} else {
+		cerr << "error: unknown solver " << solver_name << endl;
+		return 1;
+	}
+
+	vector<ReplayedSolve> solves;
+	try {
+		solves = replayLinearSystems(directory, *solver);
+	} catch(const char *error) {
+		cerr << error << endl;
+		return 1;
+	}
+
+	if(solves.empty()) {
+		cerr << "error: no solves were captured in " << directory
+				<< endl;
+		return 1;
+	}
+
+	const int spacing = 23;
+	auto space = [=] () { return setw(spacing); };
+
+	cout.precision(6);
+
+	if(verbose) {
+		cout
+			<< space() << "Solve"
+			<< space() << "Initialization (sec)"
+			<< space() << "Solve (sec)"
+			<< space() << "Iterations"
+			<< space() << "Relative Residual"
+			<< space() << "Error"
+			<< endl
+		;
+	}
+
+	Real initialization = 0., solve = 0., iterations = 0.;
+	Real residual = 0., error = 0.;
+	for(size_t k = 0; k < solves.size(); ++k) {
+		const ReplayedSolve &s = solves[k];
+		if(verbose) {
+			cout
+				<< space() << k
+				<< space() << s.initialization_seconds
+				<< space() << s.solve_seconds
+				<< space() << s.iterations
+				<< space() << s.residual
+				<< space() << s.error
+				<< endl
+			;
+		}
+
+		initialization += s.initialization_seconds;
+		solve += s.solve_seconds;
+		iterations += s.iterations;
+		residual = max(residual, s.residual);
+		error = max(error, s.error);
+	}
+
+	cout
+		<< endl
+		<< "Solves: " << solves.size() << endl
+		<< "Total initialization time (sec): " << initialization << endl
+		<< "Total solve time (sec): " << solve << endl
+		<< "Mean iterations: " << iterations / solves.size() << endl
+		<< "Maximum relative residual: " << residual << endl
+		<< "Maximum error: " << error << endl
+	;
+
+	return 0;
+}
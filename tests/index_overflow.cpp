@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+// index_overflow.cpp
+// ------------------
+//
+// Checks that RectilinearGrid refuses grids whose number of nodes does not fit
+// in the index type, and that matrices refuse more nonzeros than it can count.
+// This is built with a 32-bit index type (see QUANT_PDE_INDEX), the narrowest
+// that Eigen supports. Grids only store their axes, and stencil matrices check
+// their number of nonzeros before allocating their diagonals, so both are cheap
+// to create past the 32-bit limit.
+//
+// Usage: index_overflow fits|grid|refine|nonzeros
+////////////////////////////////////////////////////////////////////////////////
+
+#include <QuantPDE/Core>
+
+using namespace QuantPDE;
+
+#include <cstring>  // std::strcmp
+#include <iostream> // std::cerr, std::endl
+#include <limits>   // std::numeric_limits
+
+using namespace std;
+
+int main(int argc, char **argv) {
+
+	static_assert(numeric_limits<Index>::max() == 2147483647, "Build "
+			"with a 32-bit index type (-DQUANT_PDE_INDEX=std::int32_t)");
+
+	if(argc != 2) {
+		cerr << "usage: index_overflow fits|grid|refine|nonzeros"
+				<< endl;
+		return 1;
+	}
+
+	// 46340^2 = 2147395600 nodes fit in a 32-bit index
+	if(strcmp(argv[1], "fits") == 0) {
+		RectilinearGrid2 grid(
+			Axis::uniform(0., 1., 46340),
+			Axis::uniform(0., 1., 46340)
+		);
+		if(grid.size() != 2147395600) {
+			cerr << "error: wrong number of nodes" << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// The overflow checks throw; this is the expected outcome
+	try {
+
+		// 46341^2 = 2147488281 nodes do not
+		if(strcmp(argv[1], "grid") == 0) {
+			RectilinearGrid2 grid(
+				Axis::uniform(0., 1., 46341),
+				Axis::uniform(0., 1., 46341)
+			);
+			cerr << "error: " << grid.size() << " nodes were "
+					"accepted" << endl;
+			return 1;
+		}
+
+		// Refining an axis of 3 nodes 30 times yields 2^31 + 1 nodes
+		if(strcmp(argv[1], "refine") == 0) {
+			RectilinearGrid1 grid( Axis::uniform(0., 1., 3) );
+			RectilinearGrid1 refined = grid.refined(30);
+			cerr << "error: " << refined.size() << " nodes were "
+					"accepted" << endl;
+			return 1;
+		}
+
+		// 5 * 429496730 = 2147483650 nonzeros on a grid whose nodes
+		// fit (e.g. a 2-D five-point stencil)
+		if(strcmp(argv[1], "nonzeros") == 0) {
+			const Index n = 429496730;
+			StencilMatrix M(n, {-2, -1, 0, 1, 2});
+			cerr << "error: " << M.rows() << " rows of 5 nonzeros "
+					"were accepted" << endl;
+			return 1;
+		}
+
+	} catch(const char *) {
+		return 0;
+	}
+
+	cerr << "usage: index_overflow fits|grid|refine|nonzeros" << endl;
+	return 1;
+
+}